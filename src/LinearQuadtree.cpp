@@ -0,0 +1,336 @@
+/** \file LinearQuadtree.cpp
+ *  \brief Defining the pointerless variant of the data structure.
+ *
+ * File containing definition of \link LinearQuadtree \endlink.
+ */
+
+#include "LinearQuadtree.h"
+#include "QuadtreeTrace.h"
+
+#ifndef _DEBUG_QUADTREE
+#   define NDEBUG
+#endif
+
+#include <cassert>
+
+const int LinearQuadtree::MAX_DEPTH;
+
+LinearQuadtree::LinearQuadtree(float left, float width, float down, float height, int maxDepth, int bucketSize)
+:   m_entries(0), m_len(0), m_cap(0),
+    m_left(left), m_width(width), m_down(down), m_height(height), m_maxDepth(maxDepth),
+    m_bucketSize(bucketSize)
+{
+    assert( (maxDepth >= 0) && (maxDepth <= MAX_DEPTH) && (bucketSize >= 1) );
+}
+
+LinearQuadtree::~LinearQuadtree()
+{
+    if (m_cap)
+        delete[] m_entries;
+}
+
+//Private.
+//Descends the levels like Quadtree::getLeafAt, recording the quadrant chosen at each level.
+unsigned long long LinearQuadtree::getCode(float x, float y) const
+{
+    if ( !( (x >= m_left) && (x < m_left + m_width) && (y >= m_down) && (y < m_down + m_height) ) )
+        throw QuadtreeException::QE_outOfBound;
+
+    float left = m_left, width = m_width, down = m_down, height = m_height;
+    unsigned long long code = 0;
+
+    for (int d = 0; d < m_maxDepth; d++)
+    {
+        unsigned long long north = 0, east = 0;
+
+        if ( x >= left + width / 2.0f )
+        {
+            east = 1;
+            left = left + width / 2.0f;
+        }
+        if ( y >= down + height / 2.0f )
+        {
+            north = 1;
+            down = down + height / 2.0f;
+        }
+        width  /= 2.0f;
+        height /= 2.0f;
+
+        code = (code << 2) | (north << 1) | east;
+    }
+
+    return code;
+}
+
+//Private.
+//Binary search.
+int LinearQuadtree::lowerBound(int lo, int hi, unsigned long long code) const
+{
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (m_entries[mid].code < code)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+//Private.
+//Scans the entries having the same code.
+int LinearQuadtree::findEntry(const IRO_Point2D *posPtr, unsigned long long code) const
+{
+    for (int i = lowerBound(0, m_len, code); (i < m_len) && (m_entries[i].code == code); i++)
+    {
+        if (m_entries[i].posPtr == posPtr)
+            return i;
+    }
+
+    return -1;
+}
+
+//Private.
+//Inserts after the entries with equal code. The array grows geometrically.
+void LinearQuadtree::insertEntry(const Entry &entry)
+{
+    if (m_len == m_cap)
+    {
+        int newCap = m_cap ? 2 * m_cap : 16;
+        Entry *temp = new Entry[newCap];
+
+        for (int i = 0; i < m_len; i++)
+            temp[i] = m_entries[i];
+
+        if (m_cap)
+            delete[] m_entries;
+
+        m_entries = temp;
+        m_cap = newCap;
+    }
+
+    int pos = (entry.code == ~0ULL) ? m_len : lowerBound(0, m_len, entry.code + 1);
+
+    for (int i = m_len; i > pos; i--)
+        m_entries[i] = m_entries[i - 1];
+
+    m_entries[pos] = entry;
+    m_len++;
+}
+
+//Private.
+void LinearQuadtree::eraseEntry(int pos)
+{
+    assert( (pos >= 0) && (pos < m_len) );
+
+    m_len--;
+    for (int i = pos; i < m_len; i++)
+        m_entries[i] = m_entries[i + 1];
+}
+
+//Public.
+void LinearQuadtree::addPos(IRO_Point2D *posPtr)
+{
+    QUADTREE_TRACE(ADD_POS, 0, 0, 0);
+
+    Entry entry;
+    entry.x      = posPtr->getX();
+    entry.y      = posPtr->getY();
+    entry.code   = getCode(entry.x, entry.y);
+    entry.posPtr = posPtr;
+
+    insertEntry(entry);
+}
+
+//Public.
+void LinearQuadtree::removePos(IRO_Point2D *posPtr)
+{
+    QUADTREE_TRACE(REMOVE_POS, 0, 0, 0);
+
+    int pos = findEntry(posPtr, getCode(posPtr->getX(), posPtr->getY()));
+
+    if (pos < 0)
+        throw QuadtreeException::QE_badSearch;
+
+    eraseEntry(pos);
+}
+
+//Public.
+//If the point is still in its cell only the coordinates are updated, otherwise the entry is moved.
+void LinearQuadtree::updatePos(IRO_Point2D *posPtr)
+{
+    QUADTREE_TRACE(UPDATE_POS, 0, 0, 0);
+
+    Entry entry;
+    entry.x      = posPtr->getX();
+    entry.y      = posPtr->getY();
+    entry.code   = getCode(entry.x, entry.y);
+    entry.posPtr = posPtr;
+
+    int pos = findEntry(posPtr, entry.code);
+
+    if (pos >= 0)
+    {
+        m_entries[pos] = entry;
+        return;
+    }
+
+    //Old code is unknown, search all entries.
+    for (pos = 0; pos < m_len; pos++)
+    {
+        if (m_entries[pos].posPtr == posPtr)
+            break;
+    }
+
+    if (pos == m_len)
+        throw QuadtreeException::QE_badSearch; //Trying to update a point not in tree.
+
+    eraseEntry(pos);
+    insertEntry(entry);
+}
+
+//Public.
+//Descends the implicit tree, narrowing the range of entries until it would be a leaf:
+//a region with at most bucket size points or at max depth.
+std::vector<IRO_Point2D *> LinearQuadtree::getContentAt(float x, float y) const
+{
+    QUADTREE_TRACE(GET_AT, 0, 0, 0);
+
+    unsigned long long code = getCode(x, y);
+
+    int lo = 0, hi = m_len;
+
+    for (int d = 0; (d < m_maxDepth) && (hi - lo > m_bucketSize); d++)
+    {
+        //Region at depth d + 1 is the codes sharing the first d + 1 levels with code.
+        int shift = 2 * (m_maxDepth - d - 1);
+        unsigned long long first = (code >> shift) << shift;
+        unsigned long long last  = first | ((1ULL << shift) - 1);  //shift < 64 since d < maxDepth.
+
+        lo = lowerBound(lo, hi, first);
+        hi = (last == ~0ULL) ? hi : lowerBound(lo, hi, last + 1);
+    }
+
+    std::vector<IRO_Point2D *> rVal;
+    for (int i = lo; i < hi; i++)
+        rVal.push_back(m_entries[i].posPtr);
+
+    return rVal; //If region is empty, so will rVal be.
+}
+
+//Public.
+//Same traversal as Quadtree::getContentInRect, a region's points are the entries of its code range.
+std::vector<IRO_Point2D *> LinearQuadtree::getContentInRect(float left, float down, float right, float up) const
+{
+    if ( (left > right) || (down > up) )
+        throw QuadtreeException::QE_badRect;
+
+    QUADTREE_TRACE(GET_IN_RECT, 0, 0, 0);
+
+    struct Region
+    {
+        float left, down, width, height;
+        int   depth;
+        int   lo, hi;   //Range of entries.
+    };
+
+    //Depth first, each level pushes at most four and pops one.
+    Region searchStack[3 * MAX_DEPTH + 1];
+    int    nStack = 0;
+
+    std::vector<IRO_Point2D *> rVec;
+
+    if (m_len)
+    {
+        Region root = { m_left, m_down, m_width, m_height, 0, 0, m_len };
+        searchStack[nStack++] = root;
+    }
+
+    while (nStack)
+    {
+        Region cur = searchStack[--nStack];
+
+        //A region completely inside is one contiguous range, emitted without descending.
+        if ( (cur.left >= left) &&
+             (cur.left + cur.width <= right) &&
+             (cur.down >= down) &&
+             (cur.down + cur.height <= up) )
+        {
+            for (int i = cur.lo; i < cur.hi; i++)
+                rVec.push_back(m_entries[i].posPtr);
+        }
+        else if ( (cur.hi - cur.lo > m_bucketSize) && (cur.depth < m_maxDepth) ) //Would be an interleaf.
+        {
+            int shift = 2 * (m_maxDepth - cur.depth - 1);
+            unsigned long long base = (shift + 2 < 64) ?
+                                      (m_entries[cur.lo].code >> (shift + 2)) << (shift + 2) : 0;
+
+            //Entries are sorted by quadrant: SW, SE, NW, NE.
+            int bound[5];
+            bound[0] = cur.lo;
+            for (unsigned long long q = 1; q < 4; q++)
+                bound[q] = lowerBound(bound[q - 1], cur.hi, base | (q << shift));
+            bound[4] = cur.hi;
+
+            for (int q = 0; q < 4; q++)
+            {
+                Region child = { (q & 1) ? cur.left + cur.width  / 2.0f : cur.left,
+                                 (q & 2) ? cur.down + cur.height / 2.0f : cur.down,
+                                 cur.width / 2.0f, cur.height / 2.0f,
+                                 cur.depth + 1, bound[q], bound[q + 1] };
+
+                if ( (child.lo < child.hi) &&   //Empty regions have nothing to return.
+                     (child.left <= right) &&
+                     (child.left + child.width > left) &&
+                     (child.down <= up) &&
+                     (child.down + child.height > down) )
+                {
+                    //At least part of child is in rectangle.
+                    searchStack[nStack++] = child;
+                }
+            }
+        }
+        else
+        {
+            for (int i = cur.lo; i < cur.hi; i++)
+            {
+                if ( (m_entries[i].x >= left) &&
+                     (m_entries[i].x < right) &&
+                     (m_entries[i].y >= down) &&
+                     (m_entries[i].y < up) )
+                {
+                    rVec.push_back(m_entries[i].posPtr);
+                }
+            }
+        }
+    }
+
+    return rVec;
+}
+
+std::ostream &operator<<(std::ostream &out, const LinearQuadtree &tree)
+{
+    out << std::endl
+        << "[" << std::endl
+        << " left   = " << tree.m_left << std::endl
+        << " width  = " << tree.m_width << std::endl
+        << " down   = " << tree.m_down << std::endl
+        << " height = " << tree.m_height << std::endl;
+
+    if (tree.m_len)
+    {
+        for (int i = 0; i < tree.m_len; i++)
+        {
+            out << " " << std::hex << tree.m_entries[i].code << std::dec
+                << " (" << tree.m_entries[i].x << ", " << tree.m_entries[i].y << ")" << std::endl;
+        }
+    }
+    else
+    {
+        out << " --no content--" << std::endl;
+    }
+
+    out << "]" << std::endl;
+    return out;
+}
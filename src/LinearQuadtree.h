@@ -0,0 +1,167 @@
+/** \file LinearQuadtree.h
+ *  \brief Declaring the pointerless variant of the data structure.
+ *
+ * File containing declaration of \link LinearQuadtree \endlink.
+ */
+
+#ifndef LINEAR_QUADTREE_H
+#define LINEAR_QUADTREE_H
+
+#include "Quadtree.h" //IRO_Point2D and QuadtreeException are shared with the pointer tree.
+
+#include <vector>
+#include <ostream>
+
+/** \class LinearQuadtree
+ *  \brief Linear (pointerless) Point Region Quadtree.
+ *
+ * Has the same interface and subdivides the scene the same way as \link Quadtree \endlink,
+ * but no nodes are stored. Every point is stored with its Morton (Z-order) code at max depth
+ * resolution in one array sorted by code, so the points of any region are contiguous.
+ * A node of the pointer tree corresponds to a code prefix, its points are found by binary search.
+ *
+ * Reading is cache friendly, but adding and removing move the tail of the array.
+ * The tree is meant for scenes that are read much more often than changed.
+ */
+class LinearQuadtree
+{
+    public:
+        /**
+         * Creates the tree.
+         * Once the tree is created the dimensions can't be changed.
+         *
+         * @param left      Left x-coordinate.
+         * @param width     Width of scene.
+         * @param down      Down y-coordinate.
+         * @param height    Height of scene.
+         * @param maxDepth  Max depth of each node, at most \link MAX_DEPTH \endlink.
+         * @param bucketSize Most points in a leaf region, as in \link Quadtree \endlink.
+         *                   No nodes are merged, so there is no merge threshold.
+         */
+        LinearQuadtree(float, float, float, float, int, int bucketSize = 1);
+        /**
+         * Destructor.
+         * Deallocates the tree (but not the data).
+         */
+        ~LinearQuadtree();
+
+        /**
+         * Adds a point to the scene.
+         *
+         * @param posPtr Point to be added.
+         */
+        void addPos(IRO_Point2D *);
+        /**
+         * Removes a point from the scene.
+         * Will throw \link QuadtreeException::QE_badSearch \endlink if it cannot find point
+         * where it's supposed to be.
+         *
+         * @param posPtr Position to be removed.
+         */
+        void removePos(IRO_Point2D *);
+        /**
+         * Updates a point, must be called directly after change in position.
+         * If the point has left its cell at max depth the whole array is searched.
+         *
+         * @param posPtr Point to be updated.
+         */
+        void updatePos(IRO_Point2D *);
+
+        /**
+         * Returning content in smalles region containing the point.
+         * The region is the same leaf region as in \link Quadtree \endlink.
+         *
+         * @param x X-coordinate.
+         * @param y Y-coordinate.
+         * @return  The content at the smallest subregion of point.
+         */
+        std::vector<IRO_Point2D *> getContentAt(float, float)                     const;
+
+        /**
+         * Returning content in a rectangular area.
+         *
+         * @param left  Left x-coordinate of rectangle.
+         * @param down  Down y-coordinate of rectangle.
+         * @param right Right x-coordinate of rectangle.
+         * @param up    Up y-coordinate of rectangle.
+         * @return      The content inside the rectangle.
+         */
+        std::vector<IRO_Point2D *> getContentInRect(float, float, float, float)   const;
+
+        /**
+         * Largest max depth supported, two bits of the 64 bit code are used per level.
+         */
+        static const int MAX_DEPTH = 32;
+
+        friend std::ostream &operator<<(std::ostream &, const LinearQuadtree &);
+
+    private:
+        /**
+         * Point stored in the sorted array.
+         * The coordinates are copied, so filtering does not call the point.
+         */
+        struct Entry
+        {
+            unsigned long long code;    //Morton code at max depth.
+            float              x, y;    //Coordinates when added or last updated.
+            IRO_Point2D       *posPtr;
+        };
+
+        /**
+         * Computes the Morton code of a coordinate.
+         * The region is halved exactly like \link Quadtree_node::subdivide \endlink does.
+         * Will throw \link QuadtreeException::QE_outOfBound \endlink if outside scene.
+         *
+         * @param x X-coordinate.
+         * @param y Y-coordinate.
+         * @return  The code, two bits (north, east) per level with the root level first.
+         */
+        unsigned long long getCode(float, float) const;
+        /**
+         * Finds the first entry with code not less than a value.
+         *
+         * @param lo   First entry searched.
+         * @param hi   Entry after last entry searched.
+         * @param code The value.
+         * @return     Index of entry, hi if all entries are less.
+         */
+        int lowerBound(int, int, unsigned long long) const;
+        /**
+         * Finds the entry of a point with the given code.
+         *
+         * @return Index of entry, -1 if not found.
+         */
+        int findEntry(const IRO_Point2D *, unsigned long long) const;
+        /**
+         * Inserts an entry at its sorted position.
+         */
+        void insertEntry(const Entry &);
+        /**
+         * Removes the entry at an index.
+         */
+        void eraseEntry(int);
+
+        /**
+         * Entries sorted by code.
+         */
+        Entry     *m_entries;
+        int        m_len;
+        int        m_cap;
+
+        /**
+         * Bounds of scene.
+         */
+        const float m_left, m_width, m_down, m_height;
+        /**
+         * Maximum subdivisions of the tree.
+         */
+        const int   m_maxDepth;
+        /**
+         * Most points in a leaf region above max depth.
+         */
+        const int   m_bucketSize;
+};
+
+std::ostream &operator<<(std::ostream &, const LinearQuadtree &);
+
+#endif
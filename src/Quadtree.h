@@ -2,10 +2,11 @@
  *  \brief Core file declaring the data structure.
  *
  * File containing declaration of \link IRO_Point2D \endlink,
- * \link QuadtreeException \endlink and \link Quadtree \endlink.
+ * \link QuadtreeException \endlink, \link BasicQuadtree \endlink and \link Quadtree \endlink.
  *
- * The \link Quadtree_node \endlink is defined in \link Quadtree.cpp \endlink to
- * make it invisible to the user.
+ * The \link Quadtree_node \endlink is defined in \link QuadtreeImpl.h \endlink to
+ * make it invisible to the user. \link Quadtree \endlink is compiled in \link Quadtree.cpp \endlink,
+ * the implementation only has to be included to use the tree with other point types.
  */
 
 /** \mainpage Point Region Quadtree
@@ -18,7 +19,7 @@
  *   This is the doxygen generated API for my Point Region Quadtree.
  *   For full documentation, read the corresponding document.
  * \section install_sec Installing
- *   In this package you should have the core files Quadtree.cpp and Quadtree.h,
+ *   In this package you should have the core files Quadtree.cpp, Quadtree.h and QuadtreeImpl.h,
  *   the files for testing and the make files.
  *   \subsection install_sec_ide Installing with Code::Blocks
  *     To install this package with Code::Blocks, use the
@@ -38,11 +39,15 @@
 #define QUADTREE_H
 
 #include <vector> //Used ONLY for returning data, data is stored in C-style arrays (see Quadtree_node).
+#include <type_traits>
+#include <atomic>    //Operation counters, see BasicQuadtree::Counters.
+#include <cstddef>
+#include <stdint.h>  //Ids of points in snapshots, see BasicQuadtree::save.
 
 /** \class IRO_Point2D
  *  \brief Interface for Read-Only 2D point.
  *
- * All data stored must implement this interface.
+ * All data stored in a \link Quadtree \endlink must implement this interface.
  */
 class IRO_Point2D
 {
@@ -51,12 +56,32 @@ class IRO_Point2D
         virtual float getY() const = 0;
 };
 
-class Quadtree_node; //Defined inside implementation.
+/** \class IRO_Point2DAccessor
+ *  \brief Coordinate accessor of \link IRO_Point2D \endlink.
+ *
+ * A coordinate accessor tells \link BasicQuadtree \endlink how to read the coordinates of
+ * its point type. It has two static functions taking a point and returning a coordinate,
+ * so the reads are inlined. This one calls the virtual functions of the interface.
+ */
+struct IRO_Point2DAccessor
+{
+    static float getX(const IRO_Point2D &p) { return p.getX(); }
+    static float getY(const IRO_Point2D &p) { return p.getY(); }
+};
+
+template <class Point, class CoordAccessor> class Quadtree_node;          //Defined inside implementation.
+template <class Point, class CoordAccessor> class Quadtree_nodePool;      //Defined inside implementation.
+template <class Point, class CoordAccessor> class Quadtree_index;         //Defined inside implementation.
+template <class Point, class CoordAccessor> struct Quadtree_queryContext; //Defined inside implementation.
+struct QuadtreeSnapshot_content;                                            //Declared in QuadtreeSnapshot.h.
+
+class ThreadPool; //Declared in ThreadPool.h.
 
 #ifdef _DEBUG //General debugging.
 #   include <iostream>
     using namespace std;
 #   define _DEBUG_QUADTREE //Quadtree debugging.
+#   define QUADTREE_TRACING //Binary event tracing, see QuadtreeTrace.h.
 #endif
 
 #include <ostream>
@@ -64,7 +89,7 @@ class Quadtree_node; //Defined inside implementation.
 #include <exception>
 
 /** \class QuadtreeException
- *  \brief Exception class used by \link Quadtree \endlink.
+ *  \brief Exception class used by \link BasicQuadtree \endlink.
  */
 class QuadtreeException : public std::exception
 {
@@ -92,17 +117,32 @@ class QuadtreeException : public std::exception
          * Thrown when the search rectangle is defined wrongly.
          */
         static const QuadtreeException QE_badRect;
+        /**
+         * Thrown when the search radius is negative.
+         */
+        static const QuadtreeException QE_badRadius;
+        /**
+         * Thrown when a snapshot file can't be written, read or has a wrong format.
+         */
+        static const QuadtreeException QE_badFile;
 
     private:
         const std::string m_mess;
 };
 
-/** \class Quadtree
+/** \class BasicQuadtree
  *  \brief Main class of project.
  *
- * This is the Point Region Quadtree.
+ * This is the Point Region Quadtree, storing pointers to any point type.
+ * The coordinates are read through the static functions of CoordAccessor, no interface
+ * has to be implemented by the points. Any point type can be used after including
+ * \link QuadtreeImpl.h \endlink.
+ *
+ * @tparam Point         Type of the points stored.
+ * @tparam CoordAccessor Type with static functions getX and getY taking a const Point &.
  */
-class Quadtree
+template <class Point, class CoordAccessor>
+class BasicQuadtree
 {
     public:
         /**
@@ -114,20 +154,77 @@ class Quadtree
          * @param down      Down y-coordinate.
          * @param height    Height of scene.
          * @param maxDepth  Max depth of each node (maximum subdivisions of root region).
+         * @param options   Bitwise or of the OPT_ constants.
+         * @param bucketSize Most points in a leaf, a leaf holding more is subdivided (if depth < maxDepth).
+         * @param mergeSize  An interleaf holding at most this many points is merged, at most bucketSize.
+         *                   A lower value than bucketSize keeps a tree from splitting and merging the
+         *                   same node over and over when points move back and forth across a boundary.
          */
-        Quadtree(float, float, float, float, int);
+        BasicQuadtree(float, float, float, float, int, int options = OPT_NONE,
+                      int bucketSize = 1, int mergeSize = 1);
+        /**
+         * Creates the tree and adds an array of points.
+         * The tree is the same as adding the points one by one in array order,
+         * but it is built in one pass and the data of every leaf is allocated once.
+         * With more than one thread, the nodes down to splitDepth are built first and the
+         * subtrees below them are built in parallel.
+         * Will throw \link QuadtreeException::QE_outOfBound \endlink if any point is
+         * outside the scene, then no point is added.
+         *
+         * @param left      Left x-coordinate.
+         * @param width     Width of scene.
+         * @param down      Down y-coordinate.
+         * @param height    Height of scene.
+         * @param maxDepth  Max depth of each node (maximum subdivisions of root region).
+         * @param points    Points to be added.
+         * @param n         Number of points.
+         * @param options   Bitwise or of the OPT_ constants.
+         * @param nThreads  Number of threads building the tree.
+         * @param splitDepth Depth of the subtrees built in parallel, 4^splitDepth subtrees at most.
+         * @param bucketSize Most points in a leaf, as for the first constructor.
+         * @param mergeSize  Merge threshold, as for the first constructor.
+         */
+        BasicQuadtree(float, float, float, float, int, Point *const *, int,
+                      int options = OPT_NONE, int nThreads = 1, int splitDepth = 2,
+                      int bucketSize = 1, int mergeSize = 1);
         /**
          * Destructor.
          * Deallocates the tree and all of its nodes (but not the data).
+         * The nodes are released with the node pool, the tree is not walked.
          */
-        ~Quadtree();
+        ~BasicQuadtree();
+
+        static const int OPT_NONE  = 0; ///< No options.
+        /**
+         * Option keeping a hash index from point to leaf.
+         * Costs memory for the index, but \link updatePos \endlink no longer
+         * searches the whole tree when a point has moved to another leaf.
+         */
+        static const int OPT_INDEX = 1;
+        /**
+         * Option compressing the tree.
+         * A region about to be subdivided is first shrunk to the smallest cell holding its points,
+         * so chains of nodes with a single child holding points, as built for coincident points,
+         * are skipped. Finding a leaf then costs the actual branching rather than max depth.
+         * The root is never shrunk.
+         */
+        static const int OPT_COMPRESS = 2;
+        /**
+         * Option growing the scene.
+         * Adding or moving a point outside the scene doubles the region of the root towards it,
+         * as many times as needed, instead of throwing \link QuadtreeException::QE_outOfBound \endlink.
+         * The old root becomes a quadrant of the new one, no point is added again, so every
+         * doubling costs the same. Max depth still counts from the scene given to the constructor,
+         * the smallest regions do not grow with the root.
+         */
+        static const int OPT_GROW = 4;
 
         /**
          * Adds a point to the scene.
          *
          * @param posPtr Point to be added.
          */
-        void addPos(IRO_Point2D *);
+        void addPos(Point *);
         /**
          * Removes a point from the scene.
          * Will throw \link QuadtreeException::QE_badSearch \endlink if it cannot find point
@@ -135,15 +232,124 @@ class Quadtree
          *
          * @param posPtr Position to be removed.
          */
-        void removePos(IRO_Point2D *);
+        void removePos(Point *);
         /**
          * Updates a point, must be called directly after change in position.
-         * It is faster to remove a point, move the point and then add the point
-         * to the scene again.
+         * Without \link OPT_INDEX \endlink it is faster to remove a point, move the point
+         * and then add the point to the scene again.
+         *
+         * @param posPtr Point to be updated.
+         */
+        void updatePos(Point *);
+
+        /**
+         * Outcome of the try-variants of adding, removing and updating.
+         */
+        enum Status
+        {
+            ST_OK = 0,          ///< Done.
+            ST_OUT_OF_BOUND,    ///< The location is outside the scene, nothing was changed.
+            ST_NOT_FOUND        ///< The point is not in the tree, nothing was changed.
+        };
+
+        /**
+         * Adds a point like \link addPos \endlink, but returns a miss instead of throwing.
+         *
+         * @param posPtr Point to be added.
+         * @return       ST_OK, or ST_OUT_OF_BOUND.
+         */
+        Status tryAddPos(Point *)    noexcept;
+        /**
+         * Removes a point like \link removePos \endlink, but returns a miss instead of throwing.
+         *
+         * @param posPtr Position to be removed.
+         * @return       ST_OK, ST_OUT_OF_BOUND or ST_NOT_FOUND.
+         */
+        Status tryRemovePos(Point *) noexcept;
+        /**
+         * Updates a point like \link updatePos \endlink, but returns a miss instead of throwing.
+         * A point moved outside the scene stays in the tree at its old leaf.
          *
          * @param posPtr Point to be updated.
+         * @return       ST_OK, ST_OUT_OF_BOUND or ST_NOT_FOUND.
+         */
+        Status tryUpdatePos(Point *) noexcept;
+        /**
+         * Adds many points with \link tryAddPos \endlink, as one batch (see \link updateMany \endlink).
+         *
+         * @param points   Points to be added.
+         * @param n        Number of points.
+         * @param statuses [out] Status of every point, n of them.
+         * @return         Number of points not added.
          */
-        void updatePos(IRO_Point2D *);
+        int tryAddMany(Point *const *, int, Status *)    noexcept;
+        /**
+         * Removes many points with \link tryRemovePos \endlink, as one batch.
+         *
+         * @param points   Points to be removed.
+         * @param n        Number of points.
+         * @param statuses [out] Status of every point, n of them.
+         * @return         Number of points not removed.
+         */
+        int tryRemoveMany(Point *const *, int, Status *) noexcept;
+        /**
+         * Updates many points with \link tryUpdatePos \endlink, as one batch.
+         *
+         * @param points   Points to be updated.
+         * @param n        Number of points.
+         * @param statuses [out] Status of every point, n of them.
+         * @return         Number of points not updated.
+         */
+        int tryUpdateMany(Point *const *, int, Status *) noexcept;
+
+        /**
+         * Starts a batch of changes.
+         * Until \link commit \endlink, adding, removing and updating only move points between
+         * the leaves, no region is subdivided or merged. The tree can be queried during a batch,
+         * but leaves may hold more points than usual.
+         */
+        void beginBatch();
+        /**
+         * Updates many points, like calling \link updatePos \endlink for each.
+         * Outside a batch the updates are committed as a batch of their own, also when
+         * the exception of a point out of bounds or not found stops the updates.
+         *
+         * @param points Points to be updated.
+         * @param n      Number of points.
+         */
+        void updateMany(Point *const *, int);
+        /**
+         * Ends a batch and restructures the regions changed by it in one top down pass.
+         * Each region is subdivided or merged at most once.
+         */
+        void commit();
+        /**
+         * Checks if a batch has been started and not committed.
+         *
+         * @return True if in batch.
+         */
+        bool inBatch() const { return m_batch; }
+
+        /** \class Visitor
+         *  \brief Receiver of the points found by a query.
+         *
+         * The points are handed over in batches straight from the leaves,
+         * so a query does not allocate anything.
+         */
+        class Visitor
+        {
+            public:
+                virtual ~Visitor() {}
+
+                /**
+                 * Receives a batch of points found by a query.
+                 * The array is only valid during the call.
+                 *
+                 * @param points Points found.
+                 * @param n      Number of points, always positive.
+                 */
+                virtual void visit(Point *const *, int) = 0;
+        };
 
         /**
          * Returning content in smalles region containing the point.
@@ -154,7 +360,38 @@ class Quadtree
          * @param y Y-coordinate.
          * @return  The content at the smallest subregion of point.
          */
-        std::vector<IRO_Point2D *> getContentAt(float, float)                     const;
+        std::vector<Point *> getContentAt(float, float)                                     const;
+        /**
+         * Visits the content in smallest region containing the point, like
+         * \link getContentAt(float, float) \endlink but without allocating.
+         *
+         * @param x       X-coordinate.
+         * @param y       Y-coordinate.
+         * @param visitor Receives the content.
+         */
+        void getContentAt(float, float, Visitor &)                                          const;
+        /**
+         * Puts the content in smallest region containing the point in a buffer.
+         * The buffer is cleared first but keeps its capacity, so reusing the same buffer
+         * only allocates when it has to grow.
+         *
+         * @param x       X-coordinate.
+         * @param y       Y-coordinate.
+         * @param buffer  [out] The content.
+         */
+        void getContentAt(float, float, std::vector<Point *> &)                             const;
+        /**
+         * Writes the content in smallest region containing the point to an output iterator.
+         *
+         * @param x   X-coordinate.
+         * @param y   Y-coordinate.
+         * @param out Output iterator of Point *.
+         * @return    The iterator after the last point written.
+         */
+        template <class OutputIterator>
+        typename std::enable_if<!std::is_base_of<Visitor, OutputIterator>::value, OutputIterator>::type
+        getContentAt(float x, float y, OutputIterator out)                                  const
+        { IteratorVisitor<OutputIterator> visitor(out); getContentAt(x, y, visitor); return visitor.out; }
 
         /**
          * Returning content in a rectangular area.
@@ -165,44 +402,607 @@ class Quadtree
          * @param up    Up y-coordinate of rectangle.
          * @return      The content inside the rectangle.
          */
-        std::vector<IRO_Point2D *> getContentInRect(float, float, float, float)   const;
+        std::vector<Point *> getContentInRect(float, float, float, float)                   const;
+        /**
+         * Visits the content in a rectangular area, like
+         * \link getContentInRect(float, float, float, float) \endlink but without allocating.
+         *
+         * @param left    Left x-coordinate of rectangle.
+         * @param down    Down y-coordinate of rectangle.
+         * @param right   Right x-coordinate of rectangle.
+         * @param up      Up y-coordinate of rectangle.
+         * @param visitor Receives the content.
+         */
+        void getContentInRect(float, float, float, float, Visitor &)                        const;
+        /**
+         * Puts the content in a rectangular area in a buffer.
+         * The buffer is cleared first but keeps its capacity, so reusing the same buffer
+         * only allocates when it has to grow.
+         *
+         * @param left    Left x-coordinate of rectangle.
+         * @param down    Down y-coordinate of rectangle.
+         * @param right   Right x-coordinate of rectangle.
+         * @param up      Up y-coordinate of rectangle.
+         * @param buffer  [out] The content.
+         */
+        void getContentInRect(float, float, float, float, std::vector<Point *> &)           const;
+        /**
+         * Writes the content in a rectangular area to an output iterator.
+         *
+         * @param left  Left x-coordinate of rectangle.
+         * @param down  Down y-coordinate of rectangle.
+         * @param right Right x-coordinate of rectangle.
+         * @param up    Up y-coordinate of rectangle.
+         * @param out   Output iterator of Point *.
+         * @return      The iterator after the last point written.
+         */
+        template <class OutputIterator>
+        typename std::enable_if<!std::is_base_of<Visitor, OutputIterator>::value, OutputIterator>::type
+        getContentInRect(float left, float down, float right, float up, OutputIterator out) const
+        {
+            IteratorVisitor<OutputIterator> visitor(out);
+            getContentInRect(left, down, right, up, visitor);
+            return visitor.out;
+        }
+
+        /**
+         * Returning content in a circle.
+         *
+         * @param x X-coordinate of center.
+         * @param y Y-coordinate of center.
+         * @param r Radius, points at distance r are inside.
+         * @return  The content inside the circle.
+         */
+        std::vector<Point *> getContentInRadius(float, float, float)                        const;
+        /**
+         * Visits the content in a circle, like
+         * \link getContentInRadius(float, float, float) \endlink but without allocating.
+         * Regions completely inside the circle are visited without testing their points.
+         *
+         * @param x       X-coordinate of center.
+         * @param y       Y-coordinate of center.
+         * @param r       Radius.
+         * @param visitor Receives the content.
+         */
+        void getContentInRadius(float, float, float, Visitor &)                             const;
+        /**
+         * Puts the content in a circle in a buffer.
+         * The buffer is cleared first but keeps its capacity.
+         *
+         * @param x       X-coordinate of center.
+         * @param y       Y-coordinate of center.
+         * @param r       Radius.
+         * @param buffer  [out] The content.
+         */
+        void getContentInRadius(float, float, float, std::vector<Point *> &)                const;
+        /**
+         * Writes the content in a circle to an output iterator.
+         *
+         * @param x   X-coordinate of center.
+         * @param y   Y-coordinate of center.
+         * @param r   Radius.
+         * @param out Output iterator of Point *.
+         * @return    The iterator after the last point written.
+         */
+        template <class OutputIterator>
+        typename std::enable_if<!std::is_base_of<Visitor, OutputIterator>::value, OutputIterator>::type
+        getContentInRadius(float x, float y, float r, OutputIterator out)                   const
+        { IteratorVisitor<OutputIterator> visitor(out); getContentInRadius(x, y, r, visitor); return visitor.out; }
+
+        /**
+         * Query run by \link query \endlink.
+         */
+        struct Query
+        {
+            static const int AT        = 0; ///< Content at a point, like getContentAt.
+            static const int IN_RECT   = 1; ///< Content in a rectangle, like getContentInRect.
+            static const int IN_RADIUS = 2; ///< Content in a circle, like getContentInRadius.
+
+            int   type;     ///< AT, IN_RECT or IN_RADIUS.
+            float a, b;     ///< (x, y) for AT and IN_RADIUS, (left, down) for IN_RECT.
+            float c, d;     ///< (right, up) for IN_RECT, c is the radius for IN_RADIUS.
+
+            static Query at(float x, float y)
+            { Query q = { AT, x, y, x, y }; return q; }
+            static Query inRect(float left, float down, float right, float up)
+            { Query q = { IN_RECT, left, down, right, up }; return q; }
+            static Query inRadius(float x, float y, float r)
+            { Query q = { IN_RADIUS, x, y, r, 0.0f }; return q; }
+        };
+
+        /**
+         * Runs a batch of queries on the calling thread.
+         * All queries are checked first, the exception of an invalid query is thrown before any
+         * query is run. The queries are run in the Z-order of their centers, so neighbouring
+         * queries are run one after another and find the upper nodes already in cache.
+         * To run the queries in parallel, keep a \link ThreadPool \endlink and use
+         * \link query(const Query *, int, std::vector<Point *> *, ThreadPool &) \endlink.
+         *
+         * @param queries  Queries.
+         * @param n        Number of queries.
+         * @param results  [out] One buffer per query, cleared first but keeping its capacity.
+         */
+        void query(const Query *, int, std::vector<Point *> *)                              const;
+        /**
+         * Runs a batch of queries on the threads of a pool, like
+         * \link query(const Query *, int, std::vector<Point *> *) \endlink.
+         * The sorted queries are split into consecutive chunks and idle threads steal chunks,
+         * so one pool can be kept and reused for every batch.
+         *
+         * @param queries  Queries.
+         * @param n        Number of queries.
+         * @param results  [out] One buffer per query.
+         * @param threads  The threads running the queries.
+         */
+        void query(const Query *, int, std::vector<Point *> *, ThreadPool &)                const;
+
+        /**
+         * Returning the k points nearest to a location.
+         * The regions are searched best first, nearest region first, and the search stops when
+         * no region left can be nearer than the k:th point found.
+         * The location does not have to be inside the scene.
+         *
+         * @param x X-coordinate of location.
+         * @param y Y-coordinate of location.
+         * @param k Number of points wanted.
+         * @return  The min(k, number of points) nearest points, nearest first.
+         */
+        std::vector<Point *> nearest(float, float, int)                                     const;
+        /**
+         * Puts the k points nearest to a location in a buffer, like
+         * \link nearest(float, float, int) \endlink.
+         * The buffer is cleared first but keeps its capacity.
+         *
+         * @param x       X-coordinate of location.
+         * @param y       Y-coordinate of location.
+         * @param k       Number of points wanted.
+         * @param buffer  [out] The nearest points, nearest first.
+         */
+        void nearest(float, float, int, std::vector<Point *> &)                             const;
+
+        class NearestSearch; ///< Incremental nearest neighbour search.
+
+        /**
+         * Structure of the tree, gathered by \link getStats \endlink.
+         */
+        struct Stats
+        {
+            int              nodes;          ///< Nodes, the root included.
+            int              leaves;         ///< Leaves.
+            int              points;         ///< Points stored.
+            std::vector<int> depths;         ///< Nodes at each depth, indexed by depth below the root.
+            std::vector<int> occupancy;      ///< Leaves holding i points at index i, the last counts
+                                             ///< every leaf holding more than bucket size points.
+            double           emptyLeafRatio; ///< Empty leaves per leaf.
+            size_t           bytes;          ///< Memory of the nodes, the leaf data and the index.
+        };
+
+        /**
+         * Gathers the structure of the tree.
+         * Walks every node once and allocates nothing but the histograms.
+         *
+         * @return The structure.
+         */
+        Stats getStats()                                                                    const;
+
+        /**
+         * Operation counters, read by \link getCounters \endlink.
+         * The counters are only kept if QUADTREE_COUNTERS is defined when compiling the tree,
+         * otherwise the counting compiles to nothing and all counters stay zero.
+         */
+        struct Counters
+        {
+            unsigned long long subdivides;    ///< Leaves subdivided.
+            unsigned long long merges;        ///< Interleaves merged or collapsed.
+            unsigned long long findFallbacks; ///< Moves of updatePos that searched the tree for the old leaf.
+            unsigned long long leafReallocs;  ///< Data arrays of leaves reallocated when adding or removing.
+            unsigned long long queries;       ///< Queries run.
+            unsigned long long nodesVisited;  ///< Nodes visited by queries.
+        };
+
+        /**
+         * True if the tree is compiled with QUADTREE_COUNTERS.
+         */
+        static const bool COUNTERS;
+
+        /**
+         * Reads the operation counters.
+         * Queries may run on other threads while reading, each counter is read atomically.
+         *
+         * @return The counters since the tree was created or last reset.
+         */
+        Counters getCounters()                                                              const;
+        /**
+         * Sets all operation counters to zero.
+         */
+        void resetCounters();
+
+        /** \class IdGetter
+         *  \brief Gives the ids of the points written to a snapshot.
+         */
+        class IdGetter
+        {
+            public:
+                virtual ~IdGetter() {}
+
+                /**
+                 * Gets the id of a point.
+                 *
+                 * @param point The point.
+                 * @return      Its id.
+                 */
+                virtual uint64_t getId(const Point &) = 0;
+        };
+
+        /**
+         * Writes the tree to a snapshot file, to be opened by \link QuadtreeSnapshot \endlink.
+         * The nodes are written as they are, the points by the ids given by getter and the
+         * coordinates copied by the leaves. Must not be called during a batch.
+         * Will throw \link QuadtreeException::QE_badFile \endlink if the file can't be written.
+         *
+         * @param path   Path of file, overwritten.
+         * @param getter Gives the ids of the points.
+         */
+        void save(const char *, IdGetter &)                                                 const;
+        /**
+         * Writes the tree to a snapshot file, with the ids given by a function object.
+         *
+         * @param path  Path of file, overwritten.
+         * @param getId Function object taking a const Point & and returning its id, a 64 bit integer.
+         */
+        template <class IdFunc>
+        typename std::enable_if<!std::is_base_of<IdGetter, IdFunc>::value>::type
+        save(const char *path, IdFunc getId)                                                const
+        { FunctionIdGetter<IdFunc> getter(getId); save(path, getter); }
 
-        friend std::ostream &operator<<(std::ostream &, const Quadtree &);
+        template <class P, class A>
+        friend std::ostream &operator<<(std::ostream &, const BasicQuadtree<P, A> &);
 
     private:
+        friend struct Quadtree_queryContext<Point, CoordAccessor>; //Runs the queries of a batch.
+
+        typedef Quadtree_node<Point, CoordAccessor>     Node;
+        typedef Quadtree_nodePool<Point, CoordAccessor> Pool;
+        typedef Quadtree_index<Point, CoordAccessor>    Index;
+
+        /**
+         * Visitor writing to an output iterator.
+         */
+        template <class OutputIterator>
+        struct IteratorVisitor : public Visitor
+        {
+            explicit IteratorVisitor(OutputIterator o) : out(o) {}
+
+            void visit(Point *const *points, int n)
+            {
+                for (int i = 0; i < n; i++)
+                    *out++ = points[i];
+            }
+
+            OutputIterator out;
+        };
+
+        /**
+         * Id getter calling a function object.
+         */
+        template <class IdFunc>
+        struct FunctionIdGetter : public IdGetter
+        {
+            explicit FunctionIdGetter(IdFunc f) : func(f) {}
+
+            uint64_t getId(const Point &point) { return static_cast<uint64_t>( func(point) ); }
+
+            IdFunc func;
+        };
+
+        /**
+         * Visitor appending to a vector.
+         */
+        struct BufferVisitor : public Visitor
+        {
+            explicit BufferVisitor(std::vector<Point *> &b) : buffer(b) {}
+
+            void visit(Point *const *points, int n)
+            { buffer.insert(buffer.end(), points, points + n); }
+
+            std::vector<Point *> &buffer;
+        };
+
+        /**
+         * Region or point waiting in a nearest neighbour search.
+         */
+        struct Candidate
+        {
+            float  dist;    //Squared distance, lower bound for a region.
+            Node  *node;    //Null (0) if candidate is a point.
+            Point *point;
+
+            static bool nearer(const Candidate &a, const Candidate &b)  { return a.dist < b.dist; }
+            static bool farther(const Candidate &a, const Candidate &b) { return a.dist > b.dist; }
+        };
+
+        /**
+         * Visits the content of a subtree in a rectangular area.
+         * Recursive, so the traversal needs no dynamic stack. A subtree completely inside
+         * is handed to \link visitSubtree \endlink.
+         *
+         * @param node    Root of subtree, at least partly inside rectangle.
+         * @param left    Left x-coordinate of rectangle.
+         * @param down    Down y-coordinate of rectangle.
+         * @param right   Right x-coordinate of rectangle.
+         * @param up      Up y-coordinate of rectangle.
+         * @param visitor Receives the content.
+         */
+        void visitInRect(Node *, float, float, float, float, Visitor &) const;
+        /**
+         * Visits all content of a subtree, no bounds are tested.
+         *
+         * @param node    Root of subtree, completely inside the query.
+         * @param visitor Receives the content.
+         */
+        void visitSubtree(Node *, Visitor &) const;
+        /**
+         * Visits the content of a subtree in a circle.
+         *
+         * @param node    Root of subtree, at least partly inside circle.
+         * @param x       X-coordinate of center.
+         * @param y       Y-coordinate of center.
+         * @param r2      Squared radius.
+         * @param visitor Receives the content.
+         */
+        void visitInRadius(Node *, float, float, float, Visitor &) const;
+        /**
+         * Checks a batch of queries and orders them by the Z-order of their centers.
+         * Will throw the exception of the first invalid query.
+         *
+         * @param queries     Queries.
+         * @param n           Number of queries.
+         * @param [out] order Indices of the queries in running order.
+         */
+        void sortQueries(const Query *, int, int *) const;
+        /**
+         * Runs one query of a batch.
+         *
+         * @param query  The query, already checked.
+         * @param buffer [out] The content.
+         */
+        void runQuery(const Query &, std::vector<Point *> &) const;
+        /**
+         * Subdivides and merges the dirty nodes of a subtree after a batch.
+         *
+         * @param node Dirty root of subtree.
+         */
+        void restructure(Node *);
+        /**
+         * Merges the anchestors of a leaf that hold at most mergeSize points.
+         * Called after points have left the leaf. In a compressed tree the first anchestor
+         * not merged is collapsed if needed.
+         *
+         * @param leaf The leaf.
+         */
+        void mergeAbove(Node *);
+        /**
+         * Collapses an interleaf with a single child holding points, in a compressed tree.
+         * Does nothing if the tree is not compressed, the node is root or is a leaf.
+         *
+         * @param node The node.
+         */
+        void collapse(Node *);
+
+        /**
+         * Appends the records of a subtree to a snapshot.
+         *
+         * @param node    Root of subtree.
+         * @param i       Record of node, already reserved.
+         * @param content [in, out] Nodes and points of the snapshot.
+         * @param getter  Gives the ids of points.
+         */
+        void saveNode(Node *, int, QuadtreeSnapshot_content &, IdGetter &)                  const;
+
+        /**
+         * Adds, removes and updates a point, the shared part of the throwing and try-variants.
+         * Misses are checked before anything is changed, nothing here throws but running out of memory.
+         *
+         * @param posPtr The point.
+         * @return       The status.
+         */
+        Status addPoint(Point *);
+        Status removePoint(Point *);
+        Status updatePoint(Point *);
+        /**
+         * Throws the exception of a miss, does nothing for ST_OK.
+         *
+         * @param status The status.
+         */
+        static void throwStatus(Status);
+        /**
+         * Runs a try-variant on many points, as one batch.
+         *
+         * @param op       The shared part of the operation.
+         * @param points   The points.
+         * @param n        Number of points.
+         * @param statuses [out] Status of every point.
+         * @return         Number of points that were not ST_OK.
+         */
+        int tryMany(Status (BasicQuadtree::*)(Point *), Point *const *, int, Status *);
+
         /**
          * Returns the node at the specified location.
          *
          * @param x X-coordinate of location.
          * @param y Y-coordinate of location.
-         * @return  The node at the specified location.
+         * @return  The node at the specified location, null (0) if the location is outside
+         *          the region of a shrunk node in a compressed tree (no points are there).
          */
-        Quadtree_node *getLeafAt(float, float)      const;
+        Node *getLeafAt(float, float)   const;
         /**
-         * Returns the parent of the specified node.
+         * Returns the leaf a point at the specified location is to be added to.
+         * In a compressed tree, a location outside the region of a shrunk node is made room for.
          *
-         * @param node The node.
-         * @return     The parent of the node.
+         * @param x X-coordinate of location.
+         * @param y Y-coordinate of location.
+         * @return  The leaf at the specified location.
+         */
+        Node *makeLeafAt(float, float);
+        /**
+         * Grows the root until the location is inside it, with \link OPT_GROW \endlink.
+         *
+         * @param x X-coordinate of location.
+         * @param y Y-coordinate of location.
+         * @return  False if the tree can't grow, the location is not finite or the bounds would
+         *          overflow before reaching it, nothing is changed then.
+         */
+        bool growTo(float, float);
+        /**
+         * Subdivides a leaf holding more than bucket size points, and the new leaves that still do.
+         * In a compressed tree every leaf is shrunk before it is subdivided.
+         *
+         * @param leaf The leaf, its points are already indexed.
          */
-        Quadtree_node *getParent(Quadtree_node *)   const;
+        void divide(Node *);
         /**
          * Does a tree search to find a node.
          * The implemented search is depth first.
          *
          * @return The node if found, else null (0).
          */
-        Quadtree_node *find(IRO_Point2D *)          const;
+        Node *find(Point *)             const;
+        /**
+         * Updates the index entries of all points in a leaf.
+         * Does nothing if the tree has no index.
+         *
+         * @param leaf The leaf.
+         */
+        void indexLeaf(Node *);
+        /**
+         * Updates the index entries of all points below a node.
+         * Does nothing if the tree has no index.
+         *
+         * @param node The node.
+         */
+        void indexSubtree(Node *);
+        /**
+         * Adds a point to a leaf and to the totals of its anchestors.
+         *
+         * @param leaf   The leaf.
+         * @param posPtr Point added.
+         * @param x      X-coordinate of point.
+         * @param y      Y-coordinate of point.
+         */
+        void addToLeaf(Node *, Point *, float, float);
+        /**
+         * Removes a point from a leaf and from the totals of its anchestors.
+         *
+         * @param leaf   The leaf, storing the point.
+         * @param posPtr Point removed.
+         */
+        void removeFromLeaf(Node *, Point *);
+        /**
+         * Adds the nodes and leaves of a subtree to the statistics.
+         *
+         * @param node  Root of subtree.
+         * @param stats [in, out] The statistics.
+         */
+        void gatherStats(Node *, Stats &)                                                   const;
 
         /**
          * A link to the root of the tree.
          */
-        Quadtree_node *m_root;
+        Node      *m_root;
         /**
          * Maximum subdivisions of the tree.
          */
-        const int      m_maxDepth;
+        const int  m_maxDepth;
+        /**
+         * Allocator of all nodes but the root.
+         */
+        Pool      *m_pool;
+        /**
+         * Index from point to leaf, null (0) unless created with \link OPT_INDEX \endlink.
+         */
+        Index     *m_index;
+        /**
+         * True between \link beginBatch \endlink and \link commit \endlink.
+         */
+        bool       m_batch;
+        /**
+         * Most points in a leaf above max depth.
+         */
+        const int  m_bucketSize;
+        /**
+         * Interleaves holding at most this many points are merged.
+         */
+        const int  m_mergeSize;
+        /**
+         * True if created with \link OPT_COMPRESS \endlink.
+         */
+        const bool m_compressed;
+        /**
+         * True if created with \link OPT_GROW \endlink.
+         */
+        const bool m_grow;
+
+        /**
+         * Indices of \link m_counters \endlink, in the order of \link Counters \endlink.
+         */
+        enum { C_SUBDIVIDES, C_MERGES, C_FIND_FALLBACKS, C_LEAF_REALLOCS, C_QUERIES, C_NODES_VISITED,
+               N_COUNTERS };
+        /**
+         * Operation counters, mutable since queries count too.
+         * Relaxed atomics, so queries running in parallel can count.
+         */
+        mutable std::atomic<unsigned long long> m_counters[N_COUNTERS];
 };
 
-std::ostream &operator<<(std::ostream &, const Quadtree &);
+/** \class BasicQuadtree::NearestSearch
+ *  \brief Incremental nearest neighbour search.
+ *
+ * Hands out the points of a tree one at a time in order of distance to a location,
+ * so the caller can stop as soon as it has enough. Only the regions needed for the
+ * points handed out so far are opened.
+ * The tree must not be changed while searching.
+ */
+template <class Point, class CoordAccessor>
+class BasicQuadtree<Point, CoordAccessor>::NearestSearch
+{
+    public:
+        /**
+         * Starts a search.
+         *
+         * @param tree The tree searched.
+         * @param x    X-coordinate of location.
+         * @param y    Y-coordinate of location.
+         */
+        NearestSearch(const BasicQuadtree &, float, float);
+
+        /**
+         * Gets the next nearest point.
+         *
+         * @return The point, or null (0) when all points have been handed out.
+         */
+        Point *next();
+        /**
+         * Gets the squared distance of the point last returned by \link next \endlink.
+         *
+         * @return The squared distance to the location.
+         */
+        float getSquaredDistance() const { return m_lastDist; }
+
+    private:
+        std::vector<Candidate> m_queue;     //Heap with nearest first.
+        float                  m_x, m_y;
+        float                  m_lastDist;
+};
+
+template <class Point, class CoordAccessor>
+std::ostream &operator<<(std::ostream &, const BasicQuadtree<Point, CoordAccessor> &);
+
+/**
+ * The tree of \link IRO_Point2D \endlink, compiled once in \link Quadtree.cpp \endlink.
+ */
+typedef BasicQuadtree<IRO_Point2D, IRO_Point2DAccessor> Quadtree;
+
+extern template class BasicQuadtree<IRO_Point2D, IRO_Point2DAccessor>;
+extern template std::ostream &operator<<(std::ostream &, const Quadtree &);
 
 #endif
@@ -0,0 +1,3195 @@
+/** \file QuadtreeImpl.h
+ *  \brief Core file defining the data structure.
+ *
+ * File containing definition of \link Quadtree_node \endlink and \link BasicQuadtree \endlink.
+ *
+ * \link Quadtree \endlink is compiled once in \link Quadtree.cpp \endlink, this file only has to
+ * be included where \link BasicQuadtree \endlink is used with other point types.
+ */
+
+#ifndef QUADTREE_IMPL_H
+#define QUADTREE_IMPL_H
+
+#include "Quadtree.h"
+#include "ThreadPool.h"
+#include "QuadtreeSnapshot.h"
+#include "QuadtreeTrace.h"
+
+#ifdef _DEBUG_QUADTREE
+#   include <cassert>
+#   define QUADTREE_ASSERT(e) assert(e)
+#else
+#   define QUADTREE_ASSERT(e)
+#endif
+
+//Counts an operation in BasicQuadtree::m_counters, nothing is compiled without QUADTREE_COUNTERS.
+#ifdef QUADTREE_COUNTERS
+#   define QUADTREE_COUNT(c, n) m_counters[c].fetch_add(n, std::memory_order_relaxed)
+#else
+#   define QUADTREE_COUNT(c, n)
+#endif
+
+#include <new>  //Placement new, nodes are constructed in memory owned by Quadtree_nodePool.
+#include <list> //Used as a dynamic stack.
+#include <string>
+#include <algorithm> //Heaps of the nearest neighbour search.
+#include <cmath>     //Growing only towards finite locations.
+#include <stdint.h>  //Blocks find their group by masking the address.
+
+/** \class Quadtree_node
+ *  \brief Node class of the tree.
+ *
+ * The user can't access the node class directly, instead use the \link BasicQuadtree \endlink class.
+ *
+ * A node is 32 bytes on 64-bit platforms, so the block of four siblings fills two cache lines.
+ * The parent is stored once per block by the \link Quadtree_nodePool \endlink, the capacity of
+ * a leaf in front of its data, and the coordinate arrays are found from the capacity.
+ *
+ * The region is stored rather than derived from the path. Measured against 16 byte nodes with
+ * 32 bit block indices and derived regions (1e6 and 1e7 points, bucket 8), the smaller nodes
+ * found leaves up to 1.8 times faster and queried rectangles as fast, but moved points 25-40 %
+ * slower at 1e6 points, since the region of the leaf of a moved point has to be rebuilt from
+ * the root. The nodes are about a third of the memory of the tree, the leaf data the rest, so
+ * halving them again saves about 15 %. Stored regions also hold the shrunk regions of a
+ * compressed tree and the regions of a grown root, which can't be derived from the path.
+ */
+template <class Point, class CoordAccessor>
+class Quadtree_node
+{
+    public:
+        typedef Quadtree_nodePool<Point, CoordAccessor> Pool; ///< Allocator of the nodes.
+
+        /**
+         * Constructor of root.
+         *
+         * @param l     Left x-coordinate.
+         * @param w     Width of scene.
+         * @param d     Down y-coordinate.
+         * @param h     Height of scene.
+         *
+         * @see BasicQuadtree
+         */
+        Quadtree_node(float, float, float, float); //Public ctor to create root node.
+        /**
+         * Destructor of node.
+         * Deletes the data of a leaf. Sub nodes are owned by the \link Pool \endlink
+         * and are not deleted.
+         */
+        ~Quadtree_node();
+
+
+        float getDown()   const { return down;   }  ///< @return The down y-coordinate of region.
+        float getLeft()   const { return left;   }  ///< @return The left x-coordinate of region.
+        float getWidth()  const { return width;  }  ///< @return The width of region.
+        float getHeigth() const { return height; }  ///< @return The height of region.
+        float getDepth()  const { return depth;  }  ///< @return The depth of region.
+
+        /**
+         * Gets the center of the region.
+         *
+         * @param [out] x X-coordinate of center.
+         * @param [out] y Y-coordinate of center.
+         */
+        void  getCenter(float &x, float &y) const
+        { x = left + width / 2.0f; y = down + height / 2.0f; }
+
+        static const int START_CHILD = 0; ///< Enumeration of first child.
+        static const int NE = 0;          ///< Enumeration of North East child.
+        static const int NW = 1;          ///< Enumeration of North West child.
+        static const int SW = 2;          ///< Enumeration of South West child.
+        static const int SE = 3;          ///< Enumeration of South East child.
+        static const int END_CHILD = 3;   ///< Enumeration of last child.
+
+        /**
+         * Gets a child of a node.
+         *
+         * @param e Enumeration of child.
+         * @return  The child.
+         */
+        Quadtree_node *getChild(int e) const { QUADTREE_ASSERT( !isLeaf ); return &child[e]; }
+        /**
+         * Gets the parent of a node.
+         *
+         * @return The parent, or null (0) if node is root.
+         */
+        Quadtree_node *getParent()     const { return (slot == ROOT) ? 0 : Pool::getParent(this - slot); }
+
+        /**
+         * Checks if node is leaf.
+         *
+         * @return True if node is not leaf.
+         */
+        bool hasChildren()                   const { return !isLeaf; }
+
+        /**
+         * Checks for data in node.
+         *
+         * @return True if data is in node, else false.
+         */
+        bool isInNode(Point *)         const;
+
+        /**
+         * Checks if coordinate is inside region.
+         *
+         * @return True if point is inside region, else false.
+         */
+        bool isInRegion(float, float)        const;
+        /**
+         * Checks if y-coordinate is in region.
+         *
+         * @return True if y-coordinate is inside, else false.
+         */
+        bool isInInterY(float)               const;
+        /**
+         * Checks if x-coordinate is in region.
+         *
+         * @return True if x-coordinate is inside, else false.
+         */
+        bool isInInterX(float)               const;
+        /**
+         * Gets the squared distance from a coordinate to the region.
+         *
+         * @return Zero if coordinate is inside region.
+         */
+        float getSquaredDistance(float, float) const;
+        /**
+         * Gets the squared distance from a coordinate to the farthest corner of the region.
+         *
+         * @return The largest squared distance to any point of region.
+         */
+        float getSquaredFarDistance(float, float) const;
+
+        /**
+         * Subdivides the node and distributes any data stored.
+         *
+         * @param pool Pool to allocate the children from.
+         */
+        void subdivide(Pool &);
+        /**
+         * Merges the children of this node recursivelly.
+         *
+         * @param pool Pool the children are returned to.
+         */
+        void merge(Pool &);
+
+        /**
+         * Shrinks the region of a leaf to the smallest cell of the subdivision holding all its points.
+         * Used by compressed trees before subdividing, so that no chain of nodes with a single
+         * child holding points is built. The node must not be the root.
+         *
+         * @param maxDepth Maximum depth of the tree, the cell is not made deeper.
+         */
+        void shrink(int);
+        /**
+         * Grows the region of a shrunk leaf back to the quadrant of its parent.
+         */
+        void expand();
+        /**
+         * Makes room for a location in the quadrant of a shrunk interleaf, but outside its region.
+         * The node becomes an interleaf at the smallest cell holding both, the old content
+         * is moved to one of its new children. Leaves below keep their place in memory.
+         *
+         * @param pool Pool to allocate the children from.
+         * @param x    X-coordinate of location.
+         * @param y    Y-coordinate of location.
+         * @return     The new empty leaf at the location.
+         */
+        Quadtree_node *pushDown(Pool &, float, float);
+        /**
+         * Doubles the region of the root towards a location outside it.
+         * The root keeps its place in memory, so the old content moves to the new child
+         * covering the old region, as in \link pushDown \endlink. The depth of the root
+         * becomes one less, the depths of the nodes below do not change.
+         * An empty root only changes its region.
+         *
+         * @param pool Pool to allocate the children from.
+         * @param x    X-coordinate of location.
+         * @param y    Y-coordinate of location.
+         * @return     The child holding the old content, null (0) for an empty root.
+         */
+        Quadtree_node *grow(Pool &, float, float);
+        /**
+         * Doubles a region towards a location outside it, as \link grow \endlink does.
+         *
+         * @param [in, out] l Left x-coordinate of region.
+         * @param [in, out] d Down y-coordinate of region.
+         * @param [in, out] w Width of region.
+         * @param [in, out] h Height of region.
+         * @param x           X-coordinate of location.
+         * @param y           Y-coordinate of location.
+         * @return            False if the doubled region does not have finite bounds, nothing is changed then.
+         */
+        static bool growRegion(float &, float &, float &, float &, float, float);
+        /**
+         * Gets the only child holding points (must be interleaf).
+         *
+         * @return The child, or null (0) if more or less than one child holds points.
+         */
+        Quadtree_node *getOnlyChild() const;
+        /**
+         * Replaces an interleaf by its only child holding points, taking over its region and content.
+         * The empty children are returned to the pool.
+         *
+         * @param pool Pool the children are returned to.
+         */
+        void collapse(Pool &);
+
+        /**
+         * Point with its coordinates read once, used when building a tree from an array.
+         */
+        struct BuildItem
+        {
+            float        x, y;
+            Point *posPtr;
+        };
+
+        /**
+         * Builds the subtree of an empty leaf from an array of points.
+         * Gives the same subtree as adding the points one by one in array order,
+         * but the points are partitioned recursively and every leaf is allocated once
+         * at exactly the size needed.
+         *
+         * @param pool     Pool to allocate the children from.
+         * @param items    Points inside region, reordered by the call.
+         * @param n        Number of points.
+         * @param scratch  Memory for n items, used when partitioning.
+         * @param maxDepth Maximum depth of the tree.
+         * @param bucket   Most points in a leaf above max depth.
+         * @param compress True if interleaves are shrunk like in a compressed tree.
+         */
+        void build(Pool &, BuildItem *, int, BuildItem *, int, int, bool);
+
+        /**
+         * Subtree left to be built by \link build \endlink.
+         */
+        struct BuildTask
+        {
+            Quadtree_node *node;
+            BuildItem     *items;
+            BuildItem     *scratch;
+            int            n;
+        };
+
+        /**
+         * Builds the top levels of the subtree of an empty leaf, like \link build \endlink.
+         * The nodes at a given depth holding more than bucket points are left as empty leaves
+         * and recorded as tasks instead. Tasks use disjoint items and scratch, so they can be
+         * built by different threads (with different pools).
+         *
+         * @param pool      Pool to allocate the children from.
+         * @param items     Points inside region, reordered by the call.
+         * @param n         Number of points.
+         * @param scratch   Memory for n items, used when partitioning.
+         * @param maxDepth  Maximum depth of the tree.
+         * @param bucket    Most points in a leaf above max depth.
+         * @param compress  True if interleaves are shrunk like in a compressed tree.
+         * @param taskDepth Depth of the nodes recorded as tasks.
+         * @param tasks     Array receiving the tasks, room for the fewer of n and 4^(taskDepth - depth)
+         *                  tasks is enough.
+         * @param nTasks    [in, out] Number of tasks in array.
+         */
+        void buildTop(Pool &, BuildItem *, int, BuildItem *, int, int, bool, int, BuildTask *, int &);
+
+        /**
+         * Adds data to the node.
+         * The storage grows geometrically, so adding is amortized constant time.
+         * The coordinates of the point are read once and stored next to the point.
+         *
+         * @param posPtr Point to be added.
+         */
+        void addValue(Point *);
+        /**
+         * Adds data with known coordinates to the node.
+         *
+         * @param posPtr Point to be added.
+         * @param x      X-coordinate of point.
+         * @param y      Y-coordinate of point.
+         */
+        void addValue(Point *, float, float);
+        /**
+         * Removes data from the node.
+         * The last point is moved into the freed slot, so the order of the data is not kept.
+         * The storage is shrunk when it is less than a quarter full.
+         *
+         * @param posPtr Point to be removed.
+         */
+        void removeValue(Point *);
+        /**
+         * Updates the stored coordinates of data in the node.
+         *
+         * @param posPtr Point moved.
+         * @param x      New x-coordinate of point.
+         * @param y      New y-coordinate of point.
+         * @return       False if point is not in node.
+         */
+        bool updateValue(Point *, float, float);
+        /**
+         * Gets the data stored as a dynamic array.
+         *
+         * @return The data stored.
+         */
+        Point **getValues() const { QUADTREE_ASSERT( isLeaf ); return val; }
+        /**
+         * Gets the x-coordinates of the data, in the same order as \link getValues \endlink.
+         *
+         * @return The x-coordinates stored.
+         */
+        const float *getXs() const { QUADTREE_ASSERT( isLeaf ); return xs(); }
+        /**
+         * Gets the y-coordinates of the data, in the same order as \link getValues \endlink.
+         *
+         * @return The y-coordinates stored.
+         */
+        const float *getYs() const { QUADTREE_ASSERT( isLeaf ); return ys(); }
+
+        /**
+         * Gets the total amount of points inside region.
+         * Interleaves keep the total up to date, so this is constant time.
+         *
+         * @return The amount of points inside the region.
+         */
+        int getTotalLen() const { return isLeaf ? len : total; }
+        /**
+         * Adds to the total amount of points of all anchestors.
+         * Must be called when a point is added to or removed from a leaf of the tree
+         * (but not when points are redistributed by subdivide or merge).
+         *
+         * @param n Number of points added (negative if removed).
+         */
+        void addToAncestors(int);
+        /**
+         * Marks the node and its anchestors as changed by a batch.
+         * The anchestors of a dirty node are always dirty, so marking stops at the first one.
+         */
+        void markDirty();
+        /**
+         * Checks if the node has been changed by the current batch.
+         *
+         * @return True if dirty.
+         */
+        bool isDirty() const { return dirty; }
+        /**
+         * Clears the dirty flag, when the node has been restructured.
+         */
+        void clearDirty() { dirty = false; }
+        /**
+         * Gets the amount of points in this region (must be leaf).
+         *
+         * @return The amount of points in the region.
+         */
+        int getLen() const { QUADTREE_ASSERT( isLeaf ); return len; }
+        /**
+         * Gets the amount of points this region can store without reallocating (must be leaf).
+         *
+         * @return The capacity of the region.
+         */
+        int getCapacity() const { QUADTREE_ASSERT( isLeaf ); return cap(); }
+
+        static const int MIN_CAPACITY = 2; ///< Smallest capacity allocated for a leaf.
+
+        template <class P, class A>
+        friend std::ostream &operator<<(std::ostream &, const Quadtree_node<P, A> &);
+
+    private:
+        /**
+         * Private constructor to create non-root node.
+         * The parent is set for the whole block by \link Pool::allocBlock \endlink.
+         *
+         * @param e     Enumeration of node in the block of siblings.
+         * @param de    Depth of node.
+         * @param l     Left x-coordinate.
+         * @param w     Width of scene.
+         * @param d     Down y-coordinate.
+         * @param h     Height of scene.
+         */
+        Quadtree_node(int, int, float, float, float, float);
+
+        static const int ROOT = 4; ///< Place of the root, which is in no block.
+
+        /**
+         * Gets the capacity of a leaf, stored in front of its data.
+         *
+         * @return The capacity, zero if no data is allocated.
+         */
+        int    cap() const { return val ? *reinterpret_cast<const int *>(val - 1) : 0; }
+        /**
+         * Gets the coordinate arrays of a leaf, stored after the points.
+         *
+         * @return The x- or y-coordinates.
+         */
+        float *xs()  const { return reinterpret_cast<float *>(val + cap()); }
+        float *ys()  const { return xs() + cap(); }
+
+        /**
+         * Reallocates the data of a leaf.
+         *
+         * @param newCap New capacity, must be at least the current length.
+         */
+        void setCapacity(int);
+        /**
+         * Allocates the data arrays of a leaf as one block, after a slot holding the capacity.
+         *
+         * @param n          Capacity, must be positive.
+         * @param [out] v    Array of points.
+         * @param [out] x    Array of x-coordinates.
+         * @param [out] y    Array of y-coordinates.
+         */
+        static void allocData(int, Point **&, float *&, float *&);
+        /**
+         * Frees data arrays allocated by \link allocData \endlink.
+         *
+         * @param v Array of points.
+         */
+        static void freeData(Point **);
+
+        /**
+         * Reorders build items by the child containing them (must be interleaf).
+         *
+         * @param items   Points inside region.
+         * @param n       Number of points.
+         * @param scratch Memory for n items.
+         * @param [out] begin Index of first item of each child, begin[4] is n.
+         */
+        void distribute(BuildItem *, int, BuildItem *, int *) const;
+        /**
+         * Shrinks the region to the smallest cell of the subdivision holding build items.
+         *
+         * @param items    Points inside region.
+         * @param n        Number of points, must be positive.
+         * @param maxDepth Maximum depth of the tree.
+         */
+        void shrink(const BuildItem *, int, int);
+        /**
+         * Halves the region towards a box as long as the box is inside one quadrant.
+         * The halving is the same as in \link subdivide \endlink, so the region stays a cell
+         * of the subdivision.
+         *
+         * @param minX     Left x-coordinate of box.
+         * @param minY     Down y-coordinate of box.
+         * @param maxX     Right x-coordinate of box (inclusive).
+         * @param maxY     Up y-coordinate of box (inclusive).
+         * @param maxDepth The region is not made deeper than this.
+         */
+        void shrinkTo(float, float, float, float, int);
+
+        union
+        {
+            /**
+             * Children of node.
+             * The four siblings are stored contiguously in a block of the node pool.
+             */
+            Quadtree_node *child;
+            /**
+             * Data stored in leaf.
+             * Dynamic array of point pointers, followed by the coordinates of the data,
+             * copied so that subdividing and filtering do not call the points.
+             */
+            Point **val;
+        };
+        /**
+         * Bounds of region.
+         * In a compressed tree the region can be smaller than the quadrant of the parent.
+         */
+        float       left, down, width, height;  //Defines the region rectangle.
+        union
+        {
+            /**
+             * Number of data stored in all leaves below node.
+             */
+            int total;
+            /**
+             * Number of data stored in leaf.
+             */
+            int len;
+        };
+        /**
+         * Depth of node.
+         * Is in range [0, maxDepth], the root is below zero once grown.
+         */
+        short       depth;                      //Levels of subdivision, more than distance from root if compressed.
+        /**
+         * Place in the block of siblings, \link ROOT \endlink for the root.
+         */
+        unsigned char slot;
+        /**
+         * Stores the node type.
+         * True if leaf node, false if interleaved node.
+         */
+        bool        isLeaf : 1;                 //Leaves store val and len, others store child and total.
+        /**
+         * True if the node or a node below has been changed by a batch not yet committed.
+         */
+        bool        dirty  : 1;
+};
+
+template <class Point, class CoordAccessor>
+const int Quadtree_node<Point, CoordAccessor>::MIN_CAPACITY;
+
+//Public ctor, creating root.
+template <class Point, class CoordAccessor>
+Quadtree_node<Point, CoordAccessor>::Quadtree_node(float l, float w, float d, float h)
+:   val(0), left(l), down(d), width(w), height(h), len(0), depth(0), slot(ROOT), isLeaf(true), dirty(false)
+{
+    QUADTREE_TRACE(CREATE_NODE, this, 0, 0);
+}
+
+//Private ctor, creating node.
+template <class Point, class CoordAccessor>
+Quadtree_node<Point, CoordAccessor>::Quadtree_node(int e, int de, float l, float w, float d, float h)
+:   val(0), left(l), down(d), width(w), height(h), len(0), depth(de), slot(e), isLeaf(true), dirty(false)
+{
+    QUADTREE_TRACE(CREATE_NODE, this, depth, 0);
+}
+
+//Destructor, children are released by the pool.
+template <class Point, class CoordAccessor>
+Quadtree_node<Point, CoordAccessor>::~Quadtree_node()
+{
+    QUADTREE_TRACE(DESTROY_NODE, this, depth, 0);
+
+    if ( isLeaf && val )
+        freeData(val);
+}
+
+/** \class Pool
+ *  \brief Allocator of the nodes of one tree.
+ *
+ * Hands out blocks of four sibling nodes from slabs and recycles freed blocks through a free list,
+ * so subdividing and merging under churn does not touch the heap.
+ *
+ * A slab is made of aligned groups. The first cache line of a group holds the parents of its blocks
+ * and the blocks follow, each starting on a cache line, so the parent of a block is found by
+ * masking its address.
+ */
+template <class Point, class CoordAccessor>
+class Quadtree_nodePool
+{
+    public:
+        typedef Quadtree_node<Point, CoordAccessor> Node; ///< Type of the nodes allocated.
+
+        /**
+         * Creates an empty pool, no memory is allocated before the first block is requested.
+         */
+        Quadtree_nodePool();
+        /**
+         * Destroys all nodes still in use and releases the slabs.
+         * The slabs are swept linearly, the tree is never walked.
+         */
+        ~Quadtree_nodePool();
+
+        /**
+         * Gets memory for four sibling nodes.
+         * The nodes must be constructed with placement new.
+         *
+         * @param parent Parent of the siblings.
+         * @return       Uninitialized memory for four nodes.
+         */
+        Node *allocBlock(Node *);
+        /**
+         * Returns a block to the pool.
+         * The nodes must already be destroyed.
+         *
+         * @param block Block returned by allocBlock.
+         */
+        void freeBlock(Node *);
+        /**
+         * Takes over all slabs and free blocks of another pool.
+         * Used to gather the pools of subtrees built by different threads.
+         *
+         * @param other Pool left empty by the call.
+         */
+        void adopt(Quadtree_nodePool &);
+        /**
+         * Gets the memory allocated by the pool.
+         *
+         * @return Bytes of all slabs, in use or not.
+         */
+        size_t getBytes() const;
+
+        /**
+         * Gets the parent of a block of siblings.
+         *
+         * @param block Block returned by allocBlock.
+         * @return      The parent.
+         */
+        static Node *getParent(const Node *block) { return *parentOf(block); }
+        /**
+         * Sets the parent of a block of siblings, when a compressed or grown tree moves a node.
+         *
+         * @param block  Block returned by allocBlock.
+         * @param parent The new parent.
+         */
+        static void setParent(Node *block, Node *parent) { *parentOf(block) = parent; }
+
+        static const int CACHE_LINE       = 64;   ///< Alignment of the blocks.
+        static const int GROUP_BYTES      = 1024; ///< Size and alignment of a group, a power of two.
+        static const int BLOCKS_PER_GROUP = 7;    ///< Number of sibling blocks in one group.
+        static const int GROUPS_PER_SLAB  = 32;   ///< Number of groups in one slab.
+
+    private:
+        /**
+         * Storage of four siblings, or link to the next free block when unused.
+         */
+        struct alignas(CACHE_LINE) Block
+        {
+            union
+            {
+                char   mem[4 * sizeof(Node)]; //Must be first, nodes are cast to blocks.
+                Block *next;
+            };
+        };
+
+        /**
+         * Blocks sharing one cache line of parents.
+         */
+        struct alignas(GROUP_BYTES) Group
+        {
+            Node  *parents[BLOCKS_PER_GROUP]; //Null (0) if not handed out, the slab sweep must only destroy used blocks.
+            Block  blocks[BLOCKS_PER_GROUP];
+        };
+
+        /**
+         * Chunk of groups allocated at once.
+         */
+        struct Slab
+        {
+            Slab  *next;
+            char  *mem;     //Allocated memory, groups start at the first aligned address in it.
+            Group *groups;
+            int    fresh;   //Number of blocks that has been handed out at least once.
+        };
+
+        static_assert( sizeof(void *) != 8 || sizeof(Node) == 32, "Four nodes must fill two cache lines" );
+        static_assert( sizeof(Group) == GROUP_BYTES, "Blocks do not fit in a group" );
+
+        /**
+         * Gets the slot of the parent of a block.
+         *
+         * @param block Block returned by allocBlock.
+         * @return      The slot in the group of the block.
+         */
+        static Node **parentOf(const Node *block)
+        {
+            Group *group = reinterpret_cast<Group *>(reinterpret_cast<uintptr_t>(block) & ~uintptr_t(GROUP_BYTES - 1));
+            return &group->parents[reinterpret_cast<const Block *>(block) - group->blocks];
+        }
+
+        Slab  *m_slabs;     //Slabs allocated, blocks are handed out from the first.
+        Block *m_freeList;  //Freed blocks.
+};
+
+template <class Point, class CoordAccessor>
+Quadtree_nodePool<Point, CoordAccessor>::Quadtree_nodePool()
+:   m_slabs(0), m_freeList(0)
+{
+
+}
+
+template <class Point, class CoordAccessor>
+Quadtree_nodePool<Point, CoordAccessor>::~Quadtree_nodePool()
+{
+    while (m_slabs)
+    {
+        Slab *slab = m_slabs;
+        m_slabs = slab->next;
+
+        //Blocks never handed out are not initialized (parent is only read from fresh blocks).
+        for (int b = 0; b < slab->fresh; b++)
+        {
+            Group &group = slab->groups[b / BLOCKS_PER_GROUP];
+            if ( group.parents[b % BLOCKS_PER_GROUP] )
+            {
+                Node *block = reinterpret_cast<Node *>(group.blocks[b % BLOCKS_PER_GROUP].mem);
+                for (int e = Node::START_CHILD; e <= Node::END_CHILD; e++)
+                    block[e].~Node();
+            }
+        }
+
+        delete[] slab->mem;
+        delete slab;
+    }
+}
+
+//Takes a block from the free list, or the next unused block of the newest slab.
+template <class Point, class CoordAccessor>
+typename Quadtree_nodePool<Point, CoordAccessor>::Node *Quadtree_nodePool<Point, CoordAccessor>::allocBlock(Node *parent)
+{
+    Block *block;
+
+    if (m_freeList)
+    {
+        block = m_freeList;
+        m_freeList = block->next;
+    }
+    else
+    {
+        if ( !m_slabs || (m_slabs->fresh == GROUPS_PER_SLAB * BLOCKS_PER_GROUP) )
+        {
+            //new does not align beyond the fundamental alignment, so round up within a larger allocation.
+            Slab *slab = new Slab;
+            slab->mem    = new char[GROUPS_PER_SLAB * GROUP_BYTES + GROUP_BYTES - 1];
+            slab->groups = reinterpret_cast<Group *>((reinterpret_cast<uintptr_t>(slab->mem) + GROUP_BYTES - 1) &
+                                                     ~uintptr_t(GROUP_BYTES - 1));
+            slab->next   = m_slabs;
+            slab->fresh  = 0;
+            m_slabs = slab;
+        }
+        int b = m_slabs->fresh++;
+        block = &m_slabs->groups[b / BLOCKS_PER_GROUP].blocks[b % BLOCKS_PER_GROUP];
+    }
+
+    Node *mem = reinterpret_cast<Node *>(block->mem);
+    *parentOf(mem) = parent;
+
+    return mem;
+}
+
+//Puts a block on the free list.
+template <class Point, class CoordAccessor>
+void Quadtree_nodePool<Point, CoordAccessor>::freeBlock(Node *mem)
+{
+    Block *block = reinterpret_cast<Block *>(mem);
+
+    *parentOf(mem) = 0;
+    block->next = m_freeList;
+    m_freeList = block;
+}
+
+//Links the other pool's lists in front of this pool's lists.
+template <class Point, class CoordAccessor>
+void Quadtree_nodePool<Point, CoordAccessor>::adopt(Quadtree_nodePool &other)
+{
+    if (other.m_slabs)
+    {
+        Slab *last = other.m_slabs;
+        while (last->next)
+            last = last->next;
+
+        last->next = m_slabs;
+        m_slabs = other.m_slabs;
+        other.m_slabs = 0;
+    }
+
+    if (other.m_freeList)
+    {
+        Block *last = other.m_freeList;
+        while (last->next)
+            last = last->next;
+
+        last->next = m_freeList;
+        m_freeList = other.m_freeList;
+        other.m_freeList = 0;
+    }
+}
+
+template <class Point, class CoordAccessor>
+size_t Quadtree_nodePool<Point, CoordAccessor>::getBytes() const
+{
+    size_t bytes = 0;
+
+    for (Slab *slab = m_slabs; slab; slab = slab->next)
+        bytes += sizeof(Slab) + GROUPS_PER_SLAB * GROUP_BYTES + GROUP_BYTES - 1;
+
+    return bytes;
+}
+
+//Checks if point is in node.
+template <class Point, class CoordAccessor>
+bool Quadtree_node<Point, CoordAccessor>::isInNode(Point *posPtr) const
+{
+    QUADTREE_ASSERT( isLeaf );
+
+    for (int i = 0; i < len; i++)
+    {
+        if (val[i] == posPtr)
+            return true;
+    }
+
+    return false;
+}
+
+//Checks if point (x, y) is inside region.
+template <class Point, class CoordAccessor>
+bool Quadtree_node<Point, CoordAccessor>::isInRegion(float x, float y) const
+{
+    return ( (x >= left) &&  (x < left + width) && (y >= down) && (y < down + height) );
+}
+
+//Checks if x is inside x-intervall of region.
+template <class Point, class CoordAccessor>
+bool Quadtree_node<Point, CoordAccessor>::isInInterX(float x) const
+{
+    return ( (x >= left) && (x < left + width) );
+}
+
+//Checks if y is inside y-intervall of region.
+template <class Point, class CoordAccessor>
+bool Quadtree_node<Point, CoordAccessor>::isInInterY(float y) const
+{
+    return ( (y >= down) && (y < down + height) );
+}
+
+//Distance to the nearest point of region, per axis.
+template <class Point, class CoordAccessor>
+float Quadtree_node<Point, CoordAccessor>::getSquaredDistance(float x, float y) const
+{
+    float dx = 0.0f, dy = 0.0f;
+
+    if (x < left)
+        dx = left - x;
+    else if (x > left + width)
+        dx = x - (left + width);
+
+    if (y < down)
+        dy = down - y;
+    else if (y > down + height)
+        dy = y - (down + height);
+
+    return dx * dx + dy * dy;
+}
+
+//The farthest corner is on the far side of the center, per axis.
+template <class Point, class CoordAccessor>
+float Quadtree_node<Point, CoordAccessor>::getSquaredFarDistance(float x, float y) const
+{
+    float dx = (x < left + width / 2.0f) ? (left + width) - x : x - left;
+    float dy = (y < down + height / 2.0f) ? (down + height) - y : y - down;
+
+    return dx * dx + dy * dy;
+}
+
+//Points first, since they have the strictest alignment. The capacity takes a slot of a point.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::allocData(int n, Point **&v, float *&x, float *&y)
+{
+    QUADTREE_ASSERT( n > 0 );
+
+    char *mem = new char[(n + 1) * sizeof(Point *) + 2 * n * sizeof(float)];
+
+    *reinterpret_cast<int *>(mem) = n;
+
+    v = reinterpret_cast<Point **>(mem) + 1;
+    x = reinterpret_cast<float *>(v + n);
+    y = x + n;
+}
+
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::freeData(Point **v)
+{
+    delete[] reinterpret_cast<char *>(v - 1);
+}
+
+//Reallocates the data of a leaf, keeping the stored points.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::setCapacity(int newCap)
+{
+    QUADTREE_ASSERT( isLeaf );
+    QUADTREE_ASSERT( newCap >= len );
+
+    Point **tempVal = 0;
+    float        *tempXs  = 0, *tempYs = 0;
+
+    if (newCap)
+    {
+        allocData(newCap, tempVal, tempXs, tempYs);
+
+        const float *oldXs = xs(), *oldYs = ys();
+        for (int i = 0; i < len; i++)
+        {
+            tempVal[i] = val[i];
+            tempXs[i]  = oldXs[i];
+            tempYs[i]  = oldYs[i];
+        }
+    }
+
+    if (val)
+        freeData(val);
+
+    val = tempVal;
+}
+
+//Adds a point to node. Does not subdivide.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::addValue(Point *posPtr)
+{
+    addValue(posPtr, CoordAccessor::getX(*posPtr), CoordAccessor::getY(*posPtr));
+}
+
+//The capacity is doubled when full, so filling a leaf is linear in the number of points.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::addValue(Point *posPtr, float x, float y)
+{
+    QUADTREE_ASSERT( isLeaf );
+
+    QUADTREE_TRACE(ADD_VALUE, this, depth, len);
+
+    int capacity = cap();
+
+    if (len == capacity)
+    {
+        capacity = capacity ? 2 * capacity : MIN_CAPACITY;
+        setCapacity(capacity);
+    }
+
+    val[len] = posPtr;
+    reinterpret_cast<float *>(val + capacity)[len]            = x;
+    reinterpret_cast<float *>(val + capacity)[capacity + len] = y;
+    len++;
+}
+
+//Removes a point from node. Does not merge. Does not check if param is in node!
+//The last point fills the hole. The capacity is halved first when a quarter full, so that a leaf
+//oscillating around a power of two does not reallocate on every call.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::removeValue(Point *posPtr)
+{
+    QUADTREE_TRACE(REMOVE_VALUE, this, depth, len);
+
+    QUADTREE_ASSERT( isLeaf );
+    QUADTREE_ASSERT( len > 0 );
+
+    int i = 0;
+    while (val[i] != posPtr)
+        i++;    //SEGFAULT if posPtr is not in node.
+
+    float *x = xs(), *y = ys();
+    int    capacity = cap();
+
+    len--;
+    val[i] = val[len];
+    x[i]   = x[len];
+    y[i]   = y[len];
+
+    if ( (capacity > MIN_CAPACITY) && (len <= capacity / 4) )
+        setCapacity(capacity / 2);
+}
+
+//Refreshes the copied coordinates of a point.
+template <class Point, class CoordAccessor>
+bool Quadtree_node<Point, CoordAccessor>::updateValue(Point *posPtr, float x, float y)
+{
+    QUADTREE_ASSERT( isLeaf );
+
+    for (int i = 0; i < len; i++)
+    {
+        if (val[i] == posPtr)
+        {
+            xs()[i] = x;
+            ys()[i] = y;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//Subdivides the region and puts the corresponding values in children's region.
+//The four children are constructed in one block of the pool.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::subdivide(Pool &pool)
+{
+    QUADTREE_TRACE(SUBDIVIDE, this, depth, len);
+
+    //Observe: Children are not accessed before turning node to interleaf (isLeaf = false).
+    //         If child field would have been accessed before, then fields len and val would
+    //         be lost (node is union!).
+
+    Quadtree_node *newChild = pool.allocBlock(this);
+
+    //NE + +
+    new (&newChild[NE]) Quadtree_node(NE,   depth + 1,
+                                            left + width  / 2.0f, width  / 2.0f,
+                                            down + height / 2.0f, height / 2.0f);
+    //NW - +
+    new (&newChild[NW]) Quadtree_node(NW,   depth + 1,
+                                            left                , width  / 2.0f,
+                                            down + height / 2.0f, height / 2.0f);
+    //SW - -
+    new (&newChild[SW]) Quadtree_node(SW,   depth + 1,
+                                            left,                 width  / 2.0f,
+                                            down,                 height / 2.0f);
+    //SE + -
+    new (&newChild[SE]) Quadtree_node(SE,   depth + 1,
+                                            left + width  / 2.0f, width  / 2.0f,
+                                            down,                 height / 2.0f);
+
+    //The copied coordinates are used, the points are not called.
+    const float *x = xs(), *y = ys();
+    for (int i = 0; i < len; i++)
+    {
+        for (int e = START_CHILD; e <= END_CHILD; e++)
+            if ( newChild[e].isInRegion(x[i], y[i]) )
+                newChild[e].addValue(val[i], x[i], y[i]);
+
+    }
+
+    //All values are copied, remove original values.
+    if (val)
+        freeData(val);
+
+    isLeaf = false;
+
+    child = newChild;   //The total is the len of the leaf, they share memory.
+}
+
+//Merging child nodes to their parents.
+//Is recursive, the merged leaf gets a data array of exactly the size of the points in region.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::merge(Pool &pool)
+{
+    QUADTREE_TRACE(MERGE, this, depth, total);
+
+    //Merging leaves does nothing.
+    if (isLeaf)
+        return;
+
+    //If leaf, copy values to parent (this). Else do recursion (merge lower regions before merging this).
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+        if ( !child[e].isLeaf )
+            child[e].merge(pool);
+
+    //All children are now leaves.
+    int nValues = 0;
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+        nValues += child[e].len;
+
+    QUADTREE_ASSERT( nValues == total );
+
+    Point **tempVal = 0;
+    float        *tempXs  = 0, *tempYs = 0;
+
+    if (nValues)
+        allocData(nValues, tempVal, tempXs, tempYs);
+
+    //Copy values from leaves.
+    {
+        int j = 0; //Index for new data.
+        for (int e = START_CHILD; e <= END_CHILD; e++)
+        {
+            const float *x = child[e].xs(), *y = child[e].ys();
+            for (int i = 0; i < child[e].len; i++, j++)
+            {
+                tempVal[j] = child[e].val[i];
+                tempXs[j]  = x[i];
+                tempYs[j]  = y[i];
+            }
+        }
+    }
+
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+        child[e].~Quadtree_node();
+
+    pool.freeBlock(child);
+
+    isLeaf = true;
+    val = tempVal;
+    len = nValues;
+}
+
+//Halving stops at the first level where the box is split between quadrants.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::shrinkTo(float minX, float minY, float maxX, float maxY, int maxDepth)
+{
+    while (depth < maxDepth)
+    {
+        float cx = left + width  / 2.0f;
+        float cy = down + height / 2.0f;
+
+        bool east  = (minX >= cx), west  = (maxX < cx);
+        bool north = (minY >= cy), south = (maxY < cy);
+
+        if ( !(east || west) || !(north || south) )
+            break;
+
+        if (east)
+            left = cx;
+        if (north)
+            down = cy;
+        width  /= 2.0f;
+        height /= 2.0f;
+        depth++;
+    }
+}
+
+//The bounding box of the points decides the cell.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::shrink(int maxDepth)
+{
+    QUADTREE_ASSERT( isLeaf && getParent() && (len > 0) );
+
+    QUADTREE_TRACE(SHRINK, this, depth, len);
+
+    const float *x = xs(), *y = ys();
+    float minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+
+    for (int i = 1; i < len; i++)
+    {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+
+    shrinkTo(minX, minY, maxX, maxY, maxDepth);
+}
+
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::shrink(const BuildItem *items, int n, int maxDepth)
+{
+    QUADTREE_ASSERT( getParent() && (n > 0) );
+
+    float minX = items[0].x, maxX = items[0].x, minY = items[0].y, maxY = items[0].y;
+
+    for (int i = 1; i < n; i++)
+    {
+        minX = std::min(minX, items[i].x);
+        maxX = std::max(maxX, items[i].x);
+        minY = std::min(minY, items[i].y);
+        maxY = std::max(maxY, items[i].y);
+    }
+
+    shrinkTo(minX, minY, maxX, maxY, maxDepth);
+}
+
+//The quadrant is the one holding the down left corner, computed as in subdivide.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::expand()
+{
+    Quadtree_node *parent = getParent();
+
+    QUADTREE_ASSERT( parent );
+
+    float cx = parent->left + parent->width  / 2.0f;
+    float cy = parent->down + parent->height / 2.0f;
+
+    left   = (left >= cx) ? cx : parent->left;
+    down   = (down >= cy) ? cy : parent->down;
+    width  = parent->width  / 2.0f;
+    height = parent->height / 2.0f;
+    depth  = parent->depth + 1;
+}
+
+//The node keeps its place in the block of the parent, so the old content moves to a new child.
+template <class Point, class CoordAccessor>
+Quadtree_node<Point, CoordAccessor> *Quadtree_node<Point, CoordAccessor>::pushDown(Pool &pool, float x, float y)
+{
+    QUADTREE_ASSERT( !isLeaf && getParent() );
+
+    QUADTREE_TRACE(PUSH_DOWN, this, depth, total);
+
+    Quadtree_node *oldChild = child;
+    int            oldTotal = total;
+    float          l = left, d = down, w = width, h = height;
+    int            de = depth;
+
+    //The old region is a cell, its down left corner stands for it. The new cell is above it.
+    expand();
+    shrinkTo(std::min(l, x), std::min(d, y), std::max(l, x), std::max(d, y), de - 1);
+
+    isLeaf = true;
+    val    = 0;
+    len    = 0;
+    subdivide(pool);
+    total  = oldTotal;
+
+    Quadtree_node *moved = 0, *rVal = 0;
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+    {
+        if ( child[e].isInRegion(l, d) )
+            moved = &child[e];
+        else if ( child[e].isInRegion(x, y) )
+            rVal = &child[e];
+    }
+
+    QUADTREE_ASSERT( moved && rVal );
+
+    moved->left   = l;
+    moved->down   = d;
+    moved->width  = w;
+    moved->height = h;
+    moved->depth  = de;
+    moved->dirty  = dirty;
+    moved->isLeaf = false;
+    moved->child  = oldChild;
+    moved->total  = oldTotal;
+
+    Pool::setParent(oldChild, moved);
+
+    return rVal;
+}
+
+//The far edges are checked too, isInRegion adds the size to the near edge.
+template <class Point, class CoordAccessor>
+bool Quadtree_node<Point, CoordAccessor>::growRegion(float &l, float &d, float &w, float &h, float x, float y)
+{
+    float newL = (x < l) ? l - w : l;
+    float newD = (y < d) ? d - h : d;
+    float newW = 2.0f * w;
+    float newH = 2.0f * h;
+
+    if ( !std::isfinite(newL) || !std::isfinite(newD) || !std::isfinite(newW) || !std::isfinite(newH) ||
+         !std::isfinite(newL + newW) || !std::isfinite(newD + newH) )
+    {
+        return false;
+    }
+
+    l = newL;
+    d = newD;
+    w = newW;
+    h = newH;
+    return true;
+}
+
+//The old region is the quadrant away from the location on both axes.
+template <class Point, class CoordAccessor>
+Quadtree_node<Point, CoordAccessor> *Quadtree_node<Point, CoordAccessor>::grow(Pool &pool, float x, float y)
+{
+    QUADTREE_ASSERT( slot == ROOT );
+
+    QUADTREE_TRACE(GROW, this, depth, getTotalLen());
+
+    bool  west = (x < left), south = (y < down);
+    float l = left, d = down, w = width, h = height;
+    int   de = depth;
+
+    bool finite = growRegion(left, down, width, height, x, y);
+    QUADTREE_ASSERT( finite );
+    (void)finite;
+
+    depth = de - 1;
+
+    if ( isLeaf && !len )
+        return 0;
+
+    Quadtree_node *oldChild = child;    //Or the data of a leaf, they share memory.
+    int            oldTotal = total;
+    bool           wasLeaf  = isLeaf;
+
+    isLeaf = true;
+    val    = 0;
+    len    = 0;
+    subdivide(pool);
+    total  = oldTotal;
+
+    //The moved node keeps its exact region, the new siblings are computed as in subdivide.
+    Quadtree_node *moved = &child[ west ? (south ? NE : SE) : (south ? NW : SW) ];
+
+    moved->left   = l;
+    moved->down   = d;
+    moved->width  = w;
+    moved->height = h;
+    moved->depth  = de;
+    moved->dirty  = dirty;
+
+    moved->isLeaf = wasLeaf;
+    moved->child  = oldChild;
+    moved->total  = oldTotal;
+
+    if ( !wasLeaf )
+        Pool::setParent(oldChild, moved);
+
+    return moved;
+}
+
+template <class Point, class CoordAccessor>
+Quadtree_node<Point, CoordAccessor> *Quadtree_node<Point, CoordAccessor>::getOnlyChild() const
+{
+    QUADTREE_ASSERT( !isLeaf );
+
+    Quadtree_node *only = 0;
+
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+    {
+        if ( child[e].getTotalLen() )
+        {
+            if (only)
+                return 0;
+            only = &child[e];
+        }
+    }
+
+    return only;
+}
+
+//The content of the only child is moved up, the child is left an empty leaf before it is destroyed.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::collapse(Pool &pool)
+{
+    QUADTREE_TRACE(COLLAPSE, this, depth, total);
+
+    Quadtree_node *only     = getOnlyChild();
+    Quadtree_node *oldChild = child;
+
+    QUADTREE_ASSERT( only && getParent() );
+
+    left   = only->left;
+    down   = only->down;
+    width  = only->width;
+    height = only->height;
+    depth  = only->depth;
+
+    isLeaf = only->isLeaf;
+    child  = only->child;   //Or the data of a leaf, they share memory.
+    total  = only->total;
+
+    if ( !isLeaf )
+        Pool::setParent(child, this);
+
+    only->isLeaf = true;
+    only->val    = 0;
+    only->len    = 0;
+
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+    {
+        oldChild[e].merge(pool); //Empty subtrees not yet merged by a batch.
+        oldChild[e].~Quadtree_node();
+    }
+
+    pool.freeBlock(oldChild);
+}
+
+//Splitting the items between the children keeps the array order inside each child (stable partition),
+//which is the order sequential adding would have stored them in.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::distribute(BuildItem *items, int n, BuildItem *scratch, int *begin) const
+{
+    QUADTREE_ASSERT( !isLeaf );
+
+    int count[4] = { 0, 0, 0, 0 };
+    int pos[4];
+
+    //Counting pass, then scattering to scratch in child order.
+    for (int i = 0; i < n; i++)
+    {
+        //Same test order as getLeafAt. A point on no child (rounding at the far edge) goes to the last.
+        int e = START_CHILD;
+        while ( (e < END_CHILD) && !child[e].isInRegion(items[i].x, items[i].y) )
+            e++;
+        count[e]++;
+    }
+
+    begin[START_CHILD] = 0;
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+    {
+        pos[e] = begin[e];
+        begin[e + 1] = begin[e] + count[e];
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        int e = START_CHILD;
+        while ( (e < END_CHILD) && !child[e].isInRegion(items[i].x, items[i].y) )
+            e++;
+        scratch[pos[e]++] = items[i];
+    }
+
+    for (int i = 0; i < n; i++)
+        items[i] = scratch[i];
+}
+
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::build(Pool &pool, BuildItem *items, int n, BuildItem *scratch,
+                                                int maxDepth, int bucket, bool compress)
+{
+    QUADTREE_ASSERT( isLeaf && (len == 0) );
+
+    if ( compress && (slot != ROOT) && (n > bucket) && (depth < maxDepth) )
+        shrink(items, n, maxDepth);
+
+    if ( (n <= bucket) || (depth >= maxDepth) )
+    {
+        setCapacity(n);
+
+        float *x = xs(), *y = ys();
+        for (int i = 0; i < n; i++)
+        {
+            val[i] = items[i].posPtr;
+            x[i]   = items[i].x;
+            y[i]   = items[i].y;
+        }
+        len = n;
+        return;
+    }
+
+    subdivide(pool);
+    total = n;
+
+    int begin[5];
+    distribute(items, n, scratch, begin);
+
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+        child[e].build(pool, items + begin[e], begin[e + 1] - begin[e], scratch + begin[e],
+                       maxDepth, bucket, compress);
+}
+
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::buildTop(Pool &pool, BuildItem *items, int n, BuildItem *scratch,
+                             int maxDepth, int bucket, bool compress, int taskDepth, BuildTask *tasks, int &nTasks)
+{
+    QUADTREE_ASSERT( isLeaf && (len == 0) );
+
+    if ( compress && (slot != ROOT) && (n > bucket) && (depth < maxDepth) )
+        shrink(items, n, maxDepth);
+
+    if ( (n <= bucket) || (depth >= maxDepth) )
+    {
+        build(pool, items, n, scratch, maxDepth, bucket, compress);
+        return;
+    }
+
+    if (depth >= taskDepth)
+    {
+        BuildTask task = { this, items, scratch, n };
+        tasks[nTasks++] = task;
+        return;
+    }
+
+    subdivide(pool);
+    total = n;
+
+    int begin[5];
+    distribute(items, n, scratch, begin);
+
+    for (int e = START_CHILD; e <= END_CHILD; e++)
+        child[e].buildTop(pool, items + begin[e], begin[e + 1] - begin[e], scratch + begin[e],
+                          maxDepth, bucket, compress, taskDepth, tasks, nTasks);
+}
+
+//Marks nodes up to the first dirty one.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::markDirty()
+{
+    for (Quadtree_node *curNode = this; curNode && !curNode->dirty; curNode = curNode->getParent())
+        curNode->dirty = true;
+}
+
+//Updates the totals of all nodes above this.
+template <class Point, class CoordAccessor>
+void Quadtree_node<Point, CoordAccessor>::addToAncestors(int n)
+{
+    for (Quadtree_node *curNode = getParent(); curNode; curNode = curNode->getParent())
+    {
+        QUADTREE_ASSERT( !curNode->isLeaf );
+        curNode->total += n;
+    }
+}
+
+/** \class Quadtree_index
+ *  \brief Hash table from point to the leaf storing it.
+ *
+ * Open addressing with linear probing. The table is kept at most half full
+ * and is doubled when growing past that.
+ */
+template <class Point, class CoordAccessor>
+class Quadtree_index
+{
+    public:
+        typedef Quadtree_node<Point, CoordAccessor> Node; ///< Type of the leaves indexed.
+
+        /**
+         * Creates an empty index.
+         */
+        Quadtree_index();
+        /**
+         * Destructor.
+         */
+        ~Quadtree_index();
+
+        /**
+         * Gets the leaf of a point.
+         *
+         * @param posPtr The point.
+         * @return       The leaf, or null (0) if point is not indexed.
+         */
+        Node *get(const Point *) const;
+        /**
+         * Sets the leaf of a point, adding the point if not indexed.
+         *
+         * @param posPtr The point.
+         * @param node   The leaf storing the point.
+         */
+        void set(Point *, Node *);
+        /**
+         * Removes a point from the index.
+         *
+         * @param posPtr The point, does nothing if not indexed.
+         */
+        void erase(const Point *);
+        /**
+         * Gets the memory of the table.
+         *
+         * @return Bytes of the table.
+         */
+        size_t getBytes() const { return m_cap * sizeof(Entry); }
+
+        static const int MIN_CAPACITY = 16; ///< Size of the first table allocated.
+
+    private:
+        /**
+         * Gets the slot where the search for a point starts.
+         */
+        int home(const Point *) const;
+        /**
+         * Reallocates the table and reinserts all entries.
+         *
+         * @param newCap New size of table, must be a power of two.
+         */
+        void rehash(int);
+
+        struct Entry
+        {
+            Point   *key;     //Null (0) if slot is free.
+            Node *node;
+        };
+
+        Entry *m_table;
+        int    m_cap;   //Power of two, or zero before the first insertion.
+        int    m_len;
+};
+
+template <class Point, class CoordAccessor>
+const int Quadtree_index<Point, CoordAccessor>::MIN_CAPACITY;
+
+template <class Point, class CoordAccessor>
+Quadtree_index<Point, CoordAccessor>::Quadtree_index()
+:   m_table(0), m_cap(0), m_len(0)
+{
+
+}
+
+template <class Point, class CoordAccessor>
+Quadtree_index<Point, CoordAccessor>::~Quadtree_index()
+{
+    if (m_cap)
+        delete[] m_table;
+}
+
+//Multiplicative hashing, the low bits of a pointer are always zero.
+template <class Point, class CoordAccessor>
+int Quadtree_index<Point, CoordAccessor>::home(const Point *posPtr) const
+{
+    unsigned long long h = reinterpret_cast<unsigned long long>(posPtr) >> 3;
+    h *= 0x9E3779B97F4A7C15ULL;
+
+    return static_cast<int>(h >> 32) & (m_cap - 1);
+}
+
+template <class Point, class CoordAccessor>
+typename Quadtree_index<Point, CoordAccessor>::Node *Quadtree_index<Point, CoordAccessor>::get(const Point *posPtr) const
+{
+    if ( !m_cap )
+        return 0;
+
+    for (int i = home(posPtr); m_table[i].key; i = (i + 1) & (m_cap - 1))
+    {
+        if (m_table[i].key == posPtr)
+            return m_table[i].node;
+    }
+
+    return 0;
+}
+
+template <class Point, class CoordAccessor>
+void Quadtree_index<Point, CoordAccessor>::set(Point *posPtr, Node *node)
+{
+    if ( 2 * (m_len + 1) > m_cap )
+        rehash(m_cap ? 2 * m_cap : MIN_CAPACITY);
+
+    int i = home(posPtr);
+    while ( m_table[i].key && (m_table[i].key != posPtr) )
+        i = (i + 1) & (m_cap - 1);
+
+    if ( !m_table[i].key )
+    {
+        m_table[i].key = posPtr;
+        m_len++;
+    }
+    m_table[i].node = node;
+}
+
+//Removes the entry and shifts back the following entries of the cluster, so no tombstones are needed.
+template <class Point, class CoordAccessor>
+void Quadtree_index<Point, CoordAccessor>::erase(const Point *posPtr)
+{
+    if ( !m_cap )
+        return;
+
+    int i = home(posPtr);
+    while (m_table[i].key != posPtr)
+    {
+        if ( !m_table[i].key )
+            return; //Not indexed.
+        i = (i + 1) & (m_cap - 1);
+    }
+
+    m_table[i].key = 0;
+    m_len--;
+
+    for (int j = (i + 1) & (m_cap - 1); m_table[j].key; j = (j + 1) & (m_cap - 1))
+    {
+        //Entry j may fill hole i if its home slot is not in the cyclic range (i, j].
+        int h = home(m_table[j].key);
+        if ( (i <= j) ? ((h <= i) || (h > j)) : ((h <= i) && (h > j)) )
+        {
+            m_table[i] = m_table[j];
+            m_table[j].key = 0;
+            i = j;
+        }
+    }
+}
+
+template <class Point, class CoordAccessor>
+void Quadtree_index<Point, CoordAccessor>::rehash(int newCap)
+{
+    Entry *oldTable = m_table;
+    int    oldCap   = m_cap;
+
+    m_table = new Entry[newCap];
+    m_cap   = newCap;
+
+    for (int i = 0; i < newCap; i++)
+        m_table[i].key = 0;
+
+    for (int i = 0; i < oldCap; i++)
+    {
+        if (oldTable[i].key)
+        {
+            int j = home(oldTable[i].key);
+            while (m_table[j].key)
+                j = (j + 1) & (m_cap - 1);
+
+            m_table[j] = oldTable[i];
+        }
+    }
+
+    if (oldCap)
+        delete[] oldTable;
+}
+
+//----Rectangle filter----
+
+/**
+ * Selects the points of a leaf inside a rectangle.
+ * Uses the widest SIMD the processor supports. Does not depend on the point type,
+ * so it is compiled once in \link Quadtree.cpp \endlink.
+ *
+ * @param xs    X-coordinates of points.
+ * @param ys    Y-coordinates of points.
+ * @param n     Number of points, at most \link QUADTREE_FILTER_CHUNK \endlink.
+ * @param l     Left x-coordinate of rectangle (inclusive).
+ * @param d     Down y-coordinate of rectangle (inclusive).
+ * @param r     Right x-coordinate of rectangle (exclusive).
+ * @param u     Up y-coordinate of rectangle (exclusive).
+ * @param [out] idx Indices of the points inside, in increasing order.
+ * @return      Number of points inside.
+ */
+int Quadtree_filterRect(const float *, const float *, int, float, float, float, float, int *);
+
+static const int QUADTREE_FILTER_CHUNK = 64; ///< Most points filtered by one call.
+
+//----Quadtree entry----
+
+template <class Point, class CoordAccessor>
+const int BasicQuadtree<Point, CoordAccessor>::OPT_NONE;
+template <class Point, class CoordAccessor>
+const int BasicQuadtree<Point, CoordAccessor>::OPT_INDEX;
+template <class Point, class CoordAccessor>
+const int BasicQuadtree<Point, CoordAccessor>::OPT_COMPRESS;
+template <class Point, class CoordAccessor>
+const int BasicQuadtree<Point, CoordAccessor>::OPT_GROW;
+
+#ifdef QUADTREE_COUNTERS
+    template <class Point, class CoordAccessor>
+    const bool BasicQuadtree<Point, CoordAccessor>::COUNTERS = true;
+#else
+    template <class Point, class CoordAccessor>
+    const bool BasicQuadtree<Point, CoordAccessor>::COUNTERS = false;
+#endif
+
+template <class Point, class CoordAccessor>
+BasicQuadtree<Point, CoordAccessor>::BasicQuadtree(float left, float width, float down, float height, int maxDepth,
+                                                   int options, int bucketSize, int mergeSize)
+:   m_maxDepth(maxDepth), m_root(new Node(left, width, down, height)),
+    m_pool(new Pool),
+    m_index( (options & OPT_INDEX) ? new Index : 0 ),
+    m_batch(false), m_bucketSize(bucketSize), m_mergeSize(mergeSize),
+    m_compressed( (options & OPT_COMPRESS) != 0 ), m_grow( (options & OPT_GROW) != 0 )
+{
+    QUADTREE_ASSERT( (bucketSize >= 1) && (mergeSize >= 0) && (mergeSize <= bucketSize) );
+
+    resetCounters();
+}
+
+/**
+ * \brief Context of the tasks of a parallel build.
+ */
+template <class Point, class CoordAccessor>
+struct Quadtree_buildContext
+{
+    typedef Quadtree_node<Point, CoordAccessor> Node;
+
+    typename Node::BuildTask *tasks;
+    typename Node::Pool      *pools;    //One pool per task, no locking is needed.
+    int                       maxDepth;
+    int                       bucket;
+    bool                      compress;
+
+    //Thread pool task, building one subtree.
+    static void runTask(void *ctx, int i)
+    {
+        Quadtree_buildContext    *context = static_cast<Quadtree_buildContext *>(ctx);
+        typename Node::BuildTask &task    = context->tasks[i];
+
+        task.node->build(context->pools[i], task.items, task.n, task.scratch,
+                         context->maxDepth, context->bucket, context->compress);
+    }
+};
+
+//Validates all points before building, so a failing constructor leaves nothing half built.
+//With OPT_GROW the root grows to hold every point instead.
+template <class Point, class CoordAccessor>
+BasicQuadtree<Point, CoordAccessor>::BasicQuadtree(float left, float width, float down, float height, int maxDepth,
+                                                   Point *const *points, int n, int options, int nThreads, int splitDepth,
+                                                   int bucketSize, int mergeSize)
+:   m_root(new Node(left, width, down, height)), m_maxDepth(maxDepth),
+    m_pool(new Pool),
+    m_index( (options & OPT_INDEX) ? new Index : 0 ),
+    m_batch(false), m_bucketSize(bucketSize), m_mergeSize(mergeSize),
+    m_compressed( (options & OPT_COMPRESS) != 0 ), m_grow( (options & OPT_GROW) != 0 )
+{
+    QUADTREE_ASSERT( (bucketSize >= 1) && (mergeSize >= 0) && (mergeSize <= bucketSize) );
+
+    resetCounters();
+
+    QUADTREE_TRACE(BUILD, m_root, 0, n);
+
+    typename Node::BuildItem *items = new typename Node::BuildItem[2 * n];
+
+    for (int i = 0; i < n; i++)
+    {
+        items[i].x      = CoordAccessor::getX(*points[i]);
+        items[i].y      = CoordAccessor::getY(*points[i]);
+        items[i].posPtr = points[i];
+
+        //The root is still an empty leaf, growing only changes its region.
+        if ( !m_root->isInRegion(items[i].x, items[i].y) && !growTo(items[i].x, items[i].y) )
+        {
+            delete[] items;
+            delete m_root;
+            delete m_pool;
+            delete m_index;
+            throw QuadtreeException::QE_outOfBound;
+        }
+    }
+
+    typename Node::BuildTask *tasks = 0;
+    Pool                     *pools = 0;
+
+    try
+    {
+        if ( (nThreads > 1) && (splitDepth > 0) )
+        {
+            //The top levels are built by this thread, the subtrees below splitDepth in parallel.
+            //A grown root is above depth 0, so there can be more levels down to splitDepth.
+            int levels   = splitDepth - static_cast<int>( m_root->getDepth() );
+            int maxTasks = ( (levels < 15) && ((1 << (2 * levels)) < n) ) ? (1 << (2 * levels)) : n;
+            int nTasks   = 0;
+
+            tasks = new typename Node::BuildTask[maxTasks];
+
+            m_root->buildTop(*m_pool, items, n, items + n, m_maxDepth, m_bucketSize, m_compressed,
+                             splitDepth, tasks, nTasks);
+
+            pools = new Pool[nTasks];
+
+            Quadtree_buildContext<Point, CoordAccessor> context = { tasks, pools, m_maxDepth,
+                                                                    m_bucketSize, m_compressed };
+            {
+                ThreadPool threads(nThreads);
+                threads.run(context.runTask, &context, nTasks);
+            }
+
+            for (int i = 0; i < nTasks; i++)
+                m_pool->adopt(pools[i]);
+
+            delete[] pools;
+            delete[] tasks;
+            pools = 0;
+            tasks = 0;
+        }
+        else
+        {
+            m_root->build(*m_pool, items, n, items + n, m_maxDepth, m_bucketSize, m_compressed);
+        }
+    }
+    catch (...)
+    {
+        //The pools destroy the nodes built so far.
+        delete[] pools;
+        delete[] tasks;
+        delete[] items;
+        delete m_root;
+        delete m_pool;
+        delete m_index;
+        throw;
+    }
+
+    delete[] items;
+
+    indexSubtree(m_root);
+}
+
+//The pool destroys all nodes below the root without walking the tree.
+template <class Point, class CoordAccessor>
+BasicQuadtree<Point, CoordAccessor>::~BasicQuadtree()
+{
+    delete m_root;
+    delete m_pool;
+    delete m_index;
+}
+
+//Private.
+//Indexes the points of every leaf below node.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::indexSubtree(Node *node)
+{
+    if ( !m_index )
+        return;
+
+    if ( node->hasChildren() )
+    {
+        for (int e = Node::START_CHILD;
+             e <= Node::END_CHILD;
+             e++)
+        {
+            indexSubtree( node->getChild(e) );
+        }
+    }
+    else
+    {
+        indexLeaf(node);
+    }
+}
+
+//Private.
+//Points the index entries of all points in a leaf to the leaf.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::indexLeaf(Node *leaf)
+{
+    if ( !m_index )
+        return;
+
+    Point **data = leaf->getValues();
+    for (int i = 0; i < leaf->getLen(); i++)
+        m_index->set(data[i], leaf);
+}
+
+//Private.
+//A changed capacity means the data arrays of the leaf were reallocated.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::addToLeaf(Node *leaf, Point *posPtr, float x, float y)
+{
+#   ifdef QUADTREE_COUNTERS
+        int cap = leaf->getCapacity();
+#   endif
+
+    leaf->addValue(posPtr, x, y);
+    leaf->addToAncestors(1);
+
+    QUADTREE_COUNT(C_LEAF_REALLOCS, leaf->getCapacity() != cap);
+}
+
+//Private.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::removeFromLeaf(Node *leaf, Point *posPtr)
+{
+#   ifdef QUADTREE_COUNTERS
+        int cap = leaf->getCapacity();
+#   endif
+
+    leaf->removeValue(posPtr);
+    leaf->addToAncestors(-1);
+
+    QUADTREE_COUNT(C_LEAF_REALLOCS, leaf->getCapacity() != cap);
+}
+
+//Private.
+//Returns the leaf that has the point (x, y) inside region.
+//This is a directed search, we will never need to consider all nodes in the tree.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Node *BasicQuadtree<Point, CoordAccessor>::getLeafAt(float x, float y) const
+{
+    QUADTREE_TRACE(GET_LEAF, 0, 0, 0);
+
+    Node *curNode = m_root;
+
+    if ( !curNode->isInRegion(x, y) )
+        throw QuadtreeException::QE_outOfBound;
+
+    while ( curNode->hasChildren() )
+    {
+        bool noBreak = true;
+        for (int e = Node::START_CHILD;
+             e <= Node::END_CHILD;
+             e++)
+        {
+            if ( curNode->getChild(e)->isInRegion(x, y) )
+            {
+                noBreak = false;
+                curNode = curNode->getChild(e);
+                break;
+            }
+        }
+
+        if (noBreak)
+        {
+            QUADTREE_ASSERT( m_compressed ); //Only shrunk nodes leave parts of a region uncovered.
+            return 0;
+        }
+    }
+
+    return curNode;
+}
+
+//Private.
+//Descends by comparing with the centers, the child whose quadrant holds (x, y) is taken even if shrunk.
+//A shrunk leaf in the way is grown back to its quadrant, a shrunk interleaf is pushed down.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Node *BasicQuadtree<Point, CoordAccessor>::makeLeafAt(float x, float y)
+{
+    if ( !m_compressed )
+        return getLeafAt(x, y);
+
+    Node *curNode = m_root;
+
+    if ( !curNode->isInRegion(x, y) )
+        throw QuadtreeException::QE_outOfBound;
+
+    while ( curNode->hasChildren() )
+    {
+        float cx, cy;
+        curNode->getCenter(cx, cy);
+
+        Node *next = curNode->getChild( (y >= cy) ? ( (x >= cx) ? Node::NE : Node::NW )
+                                                  : ( (x >= cx) ? Node::SE : Node::SW ) );
+
+        if ( !next->isInRegion(x, y) && (next->getDepth() > curNode->getDepth() + 1) )
+        {
+            if ( next->hasChildren() )
+            {
+                QUADTREE_COUNT(C_SUBDIVIDES, 1);
+                return next->pushDown(*m_pool, x, y);
+            }
+
+            next->expand();
+        }
+
+        curNode = next;
+    }
+
+    return curNode;
+}
+
+//Private.
+//A location far outside takes one doubling per power of two of its distance, each moving only the old root.
+//The doublings are tried on the bounds first, so a location the bounds overflow before reaching changes nothing.
+template <class Point, class CoordAccessor>
+bool BasicQuadtree<Point, CoordAccessor>::growTo(float x, float y)
+{
+    if ( !m_grow || !std::isfinite(x) || !std::isfinite(y) )
+        return false;
+
+    float l = m_root->getLeft(), d = m_root->getDown(), w = m_root->getWidth(), h = m_root->getHeigth();
+
+    while ( !( (x >= l) && (x < l + w) && (y >= d) && (y < d + h) ) )
+    {
+        if ( !Node::growRegion(l, d, w, h, x, y) )
+            return false;
+    }
+
+    while ( !m_root->isInRegion(x, y) )
+    {
+        Node *moved = m_root->grow(*m_pool, x, y);
+
+        if ( moved && !moved->hasChildren() )
+            indexLeaf(moved); //The points of a leaf root have moved to a new leaf.
+    }
+
+    return true;
+}
+
+//Private.
+//Does an undirected search to find a point.
+//This is called when the value of the point has changed and
+//thus the new position cannot be guaranteed to be inside same region (see updatePos).
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Node *BasicQuadtree<Point, CoordAccessor>::find(Point *posPtr) const //Depth-First-Search.
+{
+    QUADTREE_TRACE(FIND, 0, 0, 0);
+
+    std::list<Node *> searchStack;
+
+    searchStack.push_back(m_root);
+
+    while ( !searchStack.empty() )
+    {
+        Node *curNode;
+
+        curNode = searchStack.back();
+        searchStack.pop_back();
+
+        if ( !curNode->hasChildren() )
+        {
+            if ( curNode->isInNode(posPtr) )
+                return curNode;
+        }
+        else
+        {
+            for (int e = Node::START_CHILD;
+                 e <= Node::END_CHILD;
+                 e++)
+            {
+                if ( curNode->getChild(e)->getTotalLen() ) //Skip empty subtrees.
+                    searchStack.push_back( curNode->getChild(e) );
+            }
+        }
+    }
+
+    return 0; //Did not find point.
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::addPos(Point *posPtr)
+{
+    throwStatus( addPoint(posPtr) );
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Status BasicQuadtree<Point, CoordAccessor>::tryAddPos(Point *posPtr) noexcept
+{
+    return addPoint(posPtr);
+}
+
+//Private.
+//Adds a point and subdivides the region if not max depth has been reached.
+//Subdivision is done iterativelly.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Status BasicQuadtree<Point, CoordAccessor>::addPoint(Point *posPtr)
+{
+    QUADTREE_TRACE(ADD_POS, 0, 0, 0);
+
+    float x = CoordAccessor::getX(*posPtr), y = CoordAccessor::getY(*posPtr);
+
+    if ( !m_root->isInRegion(x, y) && !growTo(x, y) )
+        return ST_OUT_OF_BOUND;
+
+    Node *curNode = makeLeafAt(x, y);
+
+    addToLeaf(curNode, posPtr, x, y);
+
+    if (m_index)
+        m_index->set(posPtr, curNode);
+
+    if (m_batch)
+    {
+        curNode->markDirty(); //Subdivided by commit.
+        return ST_OK;
+    }
+
+    if (curNode->getDepth() < m_maxDepth)
+        divide(curNode);
+
+    return ST_OK;
+}
+
+//Private.
+//If the leaf holds more than bucket size values, then subdivide (if depth < maxDepth).
+//Otherwise do nothing. Subdivision is done iterativelly.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::divide(Node *leaf)
+{
+    std::list<Node *> divideStack;
+
+    divideStack.push_back(leaf);
+
+    while ( !divideStack.empty() )
+    {
+        Node *curNode = divideStack.back();
+        divideStack.pop_back();
+
+        if ( m_compressed && curNode->getParent() &&
+             (curNode->getLen() > m_bucketSize) && (curNode->getDepth() < m_maxDepth) )
+        {
+            curNode->shrink(m_maxDepth); //Points stay in the same leaf.
+        }
+
+        if ( (curNode->getLen() > m_bucketSize) && (curNode->getDepth() < m_maxDepth) )
+        {
+            curNode->subdivide(*m_pool); //Will distribute points to new leaves.
+            QUADTREE_COUNT(C_SUBDIVIDES, 1);
+            for (int e = Node::START_CHILD;
+                 e <= Node::END_CHILD;
+                 e++)
+            {
+                divideStack.push_back( curNode->getChild(e) );
+            }
+        }
+        else if (curNode != leaf)
+        {
+            indexLeaf(curNode); //Points have moved to a new leaf.
+        }
+    }
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::removePos(Point *posPtr)
+{
+    throwStatus( removePoint(posPtr) );
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Status BasicQuadtree<Point, CoordAccessor>::tryRemovePos(Point *posPtr) noexcept
+{
+    return removePoint(posPtr);
+}
+
+//Private.
+//Does a directed search to find leaf node that contains point.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Status BasicQuadtree<Point, CoordAccessor>::removePoint(Point *posPtr)
+{
+    QUADTREE_TRACE(REMOVE_POS, 0, 0, 0);
+
+    float x = CoordAccessor::getX(*posPtr), y = CoordAccessor::getY(*posPtr);
+
+    if ( !m_root->isInRegion(x, y) )
+        return ST_OUT_OF_BOUND;
+
+    Node *curNode = getLeafAt(x, y);
+
+    if ( !curNode || !curNode->isInNode(posPtr) )
+        return ST_NOT_FOUND;
+
+    removeFromLeaf(curNode, posPtr);
+
+    if (m_index)
+        m_index->erase(posPtr);
+
+    if (m_batch)
+    {
+        curNode->markDirty(); //Merged by commit.
+        return ST_OK;
+    }
+
+    mergeAbove(curNode);
+
+    return ST_OK;
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::updatePos(Point *posPtr)
+{
+    throwStatus( updatePoint(posPtr) );
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Status BasicQuadtree<Point, CoordAccessor>::tryUpdatePos(Point *posPtr) noexcept
+{
+    return updatePoint(posPtr);
+}
+
+//Private.
+//Tells the tree that the point has changed position.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Status BasicQuadtree<Point, CoordAccessor>::updatePoint(Point *posPtr)
+{
+    QUADTREE_TRACE(UPDATE_POS, 0, 0, 0);
+
+    float x = CoordAccessor::getX(*posPtr), y = CoordAccessor::getY(*posPtr);
+
+    if ( !m_root->isInRegion(x, y) && !growTo(x, y) )
+        return ST_OUT_OF_BOUND; //The point stays where it was.
+
+    Node *curNode = getLeafAt(x, y);
+
+    //If posPtr is no longer in region, then move posPtr (early escape test).
+    //With an index both the test and finding the old node are constant time.
+    //If posPtr is still in region the test updates its copied coordinates.
+    //A location without a leaf (in a compressed tree) is always a move.
+    if ( !curNode || (m_index && (m_index->get(posPtr) != curNode)) || !curNode->updateValue(posPtr, x, y) )
+    {
+        //Find the old node where posPtr was, then remove it.
+        Node *oldNode = m_index ? m_index->get(posPtr) : find(posPtr);
+
+        QUADTREE_COUNT(C_FIND_FALLBACKS, !m_index);
+
+        if ( !oldNode )
+            return ST_NOT_FOUND; //Trying to update a point not in tree.
+
+        removeFromLeaf(oldNode, posPtr);
+
+        //In a batch the point is only moved, both leaves are restructured by commit.
+        if (m_batch)
+        {
+            oldNode->markDirty();
+
+            if ( !curNode )
+                curNode = makeLeafAt(x, y);
+
+            addToLeaf(curNode, posPtr, x, y);
+            curNode->markDirty();
+
+            if (m_index)
+                m_index->set(posPtr, curNode);
+
+            return ST_OK;
+        }
+
+        //Adds point to tree again.
+        //Must add point again before removing old one!!!
+        //If not, tree might be empty and oldNode will become parent of root (and trigger assertion).
+        addPoint(posPtr);
+
+        //Cannot use removePos since (x, y) is not its position in tree according to if-statement.
+        mergeAbove(oldNode);
+    }
+    //If point is in same region as before, then nothing but the coordinates changes.
+
+    return ST_OK;
+}
+
+//Private.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::throwStatus(Status status)
+{
+    if (status == ST_OUT_OF_BOUND)
+        throw QuadtreeException::QE_outOfBound;
+    if (status == ST_NOT_FOUND)
+        throw QuadtreeException::QE_badSearch;
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+int BasicQuadtree<Point, CoordAccessor>::tryAddMany(Point *const *points, int n, Status *statuses) noexcept
+{
+    return tryMany(&BasicQuadtree::addPoint, points, n, statuses);
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+int BasicQuadtree<Point, CoordAccessor>::tryRemoveMany(Point *const *points, int n, Status *statuses) noexcept
+{
+    return tryMany(&BasicQuadtree::removePoint, points, n, statuses);
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+int BasicQuadtree<Point, CoordAccessor>::tryUpdateMany(Point *const *points, int n, Status *statuses) noexcept
+{
+    return tryMany(&BasicQuadtree::updatePoint, points, n, statuses);
+}
+
+//Private.
+//Outside a batch the points are a batch of their own, as for updateMany.
+template <class Point, class CoordAccessor>
+int BasicQuadtree<Point, CoordAccessor>::tryMany(Status (BasicQuadtree::*op)(Point *),
+                                                 Point *const *points, int n, Status *statuses)
+{
+    bool ownBatch = !m_batch;
+    int  misses   = 0;
+
+    if (ownBatch)
+        beginBatch();
+
+    for (int i = 0; i < n; i++)
+    {
+        statuses[i] = (this->*op)(points[i]);
+        misses     += (statuses[i] != ST_OK);
+    }
+
+    if (ownBatch)
+        commit();
+
+    return misses;
+}
+
+//Private.
+//Keep the branches as small as possible.
+//The totals grow towards the root, so the anchestors to merge are the ones below the first
+//anchestor holding more than merge size points. Merging the highest merges the rest too.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::mergeAbove(Node *leaf)
+{
+    Node *top = 0;
+
+    for (Node *curNode = leaf->getParent();
+         curNode && (curNode->getTotalLen() <= m_mergeSize);
+         curNode = curNode->getParent())
+    {
+        top = curNode;
+    }
+
+    if (top)
+    {
+        top->merge(*m_pool);
+        QUADTREE_COUNT(C_MERGES, 1);
+        indexLeaf(top);
+    }
+
+    collapse( (top ? top : leaf)->getParent() );
+}
+
+//Private.
+//Only the node can have lost its second child holding points, the nodes above still have theirs.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::collapse(Node *node)
+{
+    if ( !m_compressed || !node || !node->getParent() || !node->hasChildren() || !node->getOnlyChild() )
+        return;
+
+    node->collapse(*m_pool);
+    QUADTREE_COUNT(C_MERGES, 1);
+
+    if ( !node->hasChildren() )
+        indexLeaf(node);
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::beginBatch()
+{
+    m_batch = true;
+}
+
+//Public.
+//Outside a batch the updates are a batch of their own.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::updateMany(Point *const *points, int n)
+{
+    bool ownBatch = !m_batch;
+
+    if (ownBatch)
+        beginBatch();
+
+    try
+    {
+        for (int i = 0; i < n; i++)
+            updatePos(points[i]);
+    }
+    catch (...)
+    {
+        //The points updated before the miss are kept, the batch must still be closed.
+        if (ownBatch)
+            commit();
+        throw;
+    }
+
+    if (ownBatch)
+        commit();
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::commit()
+{
+    QUADTREE_TRACE(COMMIT, 0, 0, 0);
+
+    m_batch = false;
+
+    if ( m_root->isDirty() )
+        restructure(m_root);
+}
+
+//Private.
+//Top down, so a region that ends up merged is merged once instead of its children first.
+//Only dirty nodes are visited, the rest of the tree was not changed by the batch.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::restructure(Node *node)
+{
+    node->clearDirty();
+
+    if ( node->hasChildren() )
+    {
+        if (node->getTotalLen() <= m_mergeSize)
+        {
+            node->merge(*m_pool);
+            QUADTREE_COUNT(C_MERGES, 1);
+            indexLeaf(node);
+        }
+        else
+        {
+            for (int e = Node::START_CHILD;
+                 e <= Node::END_CHILD;
+                 e++)
+            {
+                if ( node->getChild(e)->isDirty() )
+                    restructure( node->getChild(e) );
+            }
+
+            collapse(node); //The children are final, so is the number holding points.
+        }
+    }
+    else
+    {
+        //Same as the subdivision of addPos, every new node is subdivided at most once.
+        divide(node);
+    }
+}
+
+//Public.
+//Returns the point(s) in smallest region that contains (x, y).
+template <class Point, class CoordAccessor>
+std::vector<Point *> BasicQuadtree<Point, CoordAccessor>::getContentAt(float x, float y) const
+{
+    std::vector<Point *> rVal;
+    getContentAt(x, y, rVal);
+
+    return rVal; //If region is empty, so will rVal be.
+}
+
+//Public.
+//The data of the leaf is visited in place.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::getContentAt(float x, float y, Visitor &visitor) const
+{
+    Node *curNode = getLeafAt(x, y);
+
+    QUADTREE_COUNT(C_QUERIES, 1);
+#   ifdef QUADTREE_COUNTERS
+        for (Node *n = curNode; n; n = n->getParent())
+            QUADTREE_COUNT(C_NODES_VISITED, 1);
+#   endif
+
+    if ( !curNode )
+        return; //Outside the region of a shrunk node, there are no points.
+
+    QUADTREE_TRACE(GET_AT, curNode, curNode->getDepth(), curNode->getLen());
+
+    if ( curNode->getLen() )
+        visitor.visit(curNode->getValues(), curNode->getLen());
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::getContentAt(float x, float y, std::vector<Point *> &buffer) const
+{
+    buffer.clear();
+
+    BufferVisitor visitor(buffer);
+    getContentAt(x, y, visitor);
+}
+
+//Public.
+//Returning points in rectangular region.
+template <class Point, class CoordAccessor>
+std::vector<Point *> BasicQuadtree<Point, CoordAccessor>::getContentInRect(float left, float down, float right, float up) const
+{
+    std::vector<Point *> rVec;
+    getContentInRect(left, down, right, up, rVec);
+
+    return rVec;
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::getContentInRect(float left, float down, float right, float up,
+                                                           Visitor &visitor) const
+{
+    if ( (left > right) || (down > up) )
+        throw QuadtreeException::QE_badRect;
+
+    QUADTREE_TRACE(GET_IN_RECT, 0, 0, 0);
+
+    QUADTREE_COUNT(C_QUERIES, 1);
+    visitInRect(m_root, left, down, right, up, visitor);
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::getContentInRect(float left, float down, float right, float up,
+                                                           std::vector<Point *> &buffer) const
+{
+    buffer.clear();
+
+    BufferVisitor visitor(buffer);
+    getContentInRect(left, down, right, up, visitor);
+}
+
+//Public.
+//Returning points in circular region.
+template <class Point, class CoordAccessor>
+std::vector<Point *> BasicQuadtree<Point, CoordAccessor>::getContentInRadius(float x, float y, float r) const
+{
+    std::vector<Point *> rVec;
+    getContentInRadius(x, y, r, rVec);
+
+    return rVec;
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::getContentInRadius(float x, float y, float r, Visitor &visitor) const
+{
+    if (r < 0.0f)
+        throw QuadtreeException::QE_badRadius;
+
+    QUADTREE_TRACE(GET_IN_RADIUS, 0, 0, 0);
+
+    QUADTREE_COUNT(C_QUERIES, 1);
+    if (m_root->getSquaredDistance(x, y) <= r * r)
+        visitInRadius(m_root, x, y, r * r, visitor);
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::getContentInRadius(float x, float y, float r,
+                                                             std::vector<Point *> &buffer) const
+{
+    buffer.clear();
+
+    BufferVisitor visitor(buffer);
+    getContentInRadius(x, y, r, visitor);
+}
+
+//Private.
+//A node completely inside is swept without any more bounds tests. Partial leaves are filtered on
+//the copied coordinates, in chunks so the indices and the points found fit on the stack.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::visitInRect(Node *node, float left, float down, float right, float up,
+                                                      Visitor &visitor) const
+{
+    QUADTREE_COUNT(C_NODES_VISITED, 1);
+
+    //The points of a region are strictly left of and below its far edges.
+    if ( (node->getLeft() >= left) &&
+         (node->getLeft() + node->getWidth() <= right) &&
+         (node->getDown() >= down) &&
+         (node->getDown() + node->getHeigth() <= up) )
+    {
+        visitSubtree(node, visitor);
+    }
+    else if ( node->hasChildren() )
+    {
+        for (int e = Node::START_CHILD;
+             e <= Node::END_CHILD;
+             e++)
+        {
+            Node *curChild = node->getChild(e);
+            if ( curChild->getTotalLen() &&   //Empty subtrees have nothing to return.
+                 (curChild->getLeft() <= right) &&
+                 (curChild->getLeft() + curChild->getWidth() > left) &&
+                 (curChild->getDown() <= up) &&
+                 (curChild->getDown() + curChild->getHeigth() > down) )
+            {
+                //At least part of curChild is in rectangle.
+                visitInRect(curChild, left, down, right, up, visitor);
+            }
+        }
+    }
+    else
+    {
+        Point       **data = node->getValues();
+        const float  *xs   = node->getXs();
+        const float  *ys   = node->getYs();
+        int    idx[QUADTREE_FILTER_CHUNK];
+        Point *found[QUADTREE_FILTER_CHUNK];
+
+        for (int i = 0; i < node->getLen(); i += QUADTREE_FILTER_CHUNK)
+        {
+            int n = node->getLen() - i < QUADTREE_FILTER_CHUNK ? node->getLen() - i : QUADTREE_FILTER_CHUNK;
+            int k = Quadtree_filterRect(xs + i, ys + i, n, left, down, right, up, idx);
+
+            for (int j = 0; j < k; j++)
+                found[j] = data[i + idx[j]];
+
+            if (k)
+                visitor.visit(found, k);
+        }
+    }
+}
+
+//Private.
+//Visits the data arrays of all non-empty leaves below node in place.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::visitSubtree(Node *node, Visitor &visitor) const
+{
+    if ( node->hasChildren() )
+    {
+        for (int e = Node::START_CHILD;
+             e <= Node::END_CHILD;
+             e++)
+        {
+            if ( node->getChild(e)->getTotalLen() )
+            {
+                QUADTREE_COUNT(C_NODES_VISITED, 1); //The node itself is counted by the caller.
+                visitSubtree(node->getChild(e), visitor);
+            }
+        }
+    }
+    else if ( node->getLen() )
+    {
+        visitor.visit(node->getValues(), node->getLen());
+    }
+}
+
+//Private.
+//A region whose farthest corner is inside is swept like in visitInRect. Children are pruned by
+//their exact distance to the center, only the points of boundary leaves are tested.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::visitInRadius(Node *node, float x, float y, float r2,
+                                                        Visitor &visitor) const
+{
+    QUADTREE_COUNT(C_NODES_VISITED, 1);
+
+    if (node->getSquaredFarDistance(x, y) <= r2)
+    {
+        visitSubtree(node, visitor);
+    }
+    else if ( node->hasChildren() )
+    {
+        for (int e = Node::START_CHILD;
+             e <= Node::END_CHILD;
+             e++)
+        {
+            Node *curChild = node->getChild(e);
+            if ( curChild->getTotalLen() && (curChild->getSquaredDistance(x, y) <= r2) )
+                visitInRadius(curChild, x, y, r2, visitor);
+        }
+    }
+    else
+    {
+        Point       **data = node->getValues();
+        const float  *xs   = node->getXs();
+        const float  *ys   = node->getYs();
+        Point *found[QUADTREE_FILTER_CHUNK];
+        int    k = 0;
+
+        for (int i = 0; i < node->getLen(); i++)
+        {
+            //Branch free, like the rectangle filter.
+            found[k] = data[i];
+            k += ( (xs[i] - x) * (xs[i] - x) + (ys[i] - y) * (ys[i] - y) <= r2 );
+
+            if (k == QUADTREE_FILTER_CHUNK)
+            {
+                visitor.visit(found, k);
+                k = 0;
+            }
+        }
+
+        if (k)
+            visitor.visit(found, k);
+    }
+}
+
+/**
+ * \brief Context of the tasks of a parallel batch of queries.
+ */
+template <class Point, class CoordAccessor>
+struct Quadtree_queryContext
+{
+    typedef BasicQuadtree<Point, CoordAccessor> Tree;
+
+    const Tree                  *tree;
+    const typename Tree::Query  *queries;
+    std::vector<Point *>        *results;
+    const int                   *order;     //Queries in running order.
+    int                          n;
+    int                          nTasks;
+
+    //Thread pool task, running one chunk of consecutive queries in running order.
+    static void runTask(void *ctx, int i)
+    {
+        Quadtree_queryContext *context = static_cast<Quadtree_queryContext *>(ctx);
+
+        int begin = static_cast<int>( static_cast<long long>(context->n) * i / context->nTasks );
+        int end   = static_cast<int>( static_cast<long long>(context->n) * (i + 1) / context->nTasks );
+
+        for (int j = begin; j < end; j++)
+        {
+            int q = context->order[j];
+            context->tree->runQuery(context->queries[q], context->results[q]);
+        }
+    }
+};
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::query(const Query *queries, int n, std::vector<Point *> *results) const
+{
+    int *order = new int[n];
+
+    try
+    {
+        sortQueries(queries, n, order);
+    }
+    catch (...)
+    {
+        delete[] order;
+        throw;
+    }
+
+    for (int j = 0; j < n; j++)
+        runQuery(queries[order[j]], results[order[j]]);
+
+    delete[] order;
+}
+
+//Public.
+//A few chunks per thread, so there is something left to steal when the queries are uneven.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::query(const Query *queries, int n, std::vector<Point *> *results,
+                                                ThreadPool &threads) const
+{
+    int *order = new int[n];
+
+    try
+    {
+        sortQueries(queries, n, order);
+    }
+    catch (...)
+    {
+        delete[] order;
+        throw;
+    }
+
+    int nTasks = 4 * threads.getThreads() < n ? 4 * threads.getThreads() : n;
+
+    Quadtree_queryContext<Point, CoordAccessor> context = { this, queries, results, order, n, nTasks };
+    threads.run(context.runTask, &context, nTasks);
+
+    delete[] order;
+}
+
+//Spreads the 16 low bits of v to the even bits.
+inline unsigned Quadtree_spreadBits(unsigned v)
+{
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+//Private.
+//The centers are quantized to 16 bits per axis inside the scene, which is fine enough for ordering.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::sortQueries(const Query *queries, int n, int *order) const
+{
+    for (int i = 0; i < n; i++)
+    {
+        const Query &q = queries[i];
+
+        switch (q.type)
+        {
+            case Query::AT:
+                if ( !m_root->isInRegion(q.a, q.b) )
+                    throw QuadtreeException::QE_outOfBound;
+                break;
+            case Query::IN_RECT:
+                if ( (q.a > q.c) || (q.b > q.d) )
+                    throw QuadtreeException::QE_badRect;
+                break;
+            case Query::IN_RADIUS:
+                if (q.c < 0.0f)
+                    throw QuadtreeException::QE_badRadius;
+                break;
+            default:
+                QUADTREE_ASSERT( false ); //Unknown query.
+                break;
+        }
+    }
+
+    std::vector< std::pair<unsigned, int> > keys(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        const Query &q = queries[i];
+
+        float cx = (q.type == Query::IN_RECT) ? (q.a + q.c) / 2.0f : q.a;
+        float cy = (q.type == Query::IN_RECT) ? (q.b + q.d) / 2.0f : q.b;
+
+        float fx = (cx - m_root->getLeft()) / m_root->getWidth();
+        float fy = (cy - m_root->getDown()) / m_root->getHeigth();
+        fx = fx < 0.0f ? 0.0f : (fx > 1.0f ? 1.0f : fx);
+        fy = fy < 0.0f ? 0.0f : (fy > 1.0f ? 1.0f : fy);
+
+        unsigned code = (Quadtree_spreadBits( static_cast<unsigned>(fy * 65535.0f) ) << 1) |
+                         Quadtree_spreadBits( static_cast<unsigned>(fx * 65535.0f) );
+
+        keys[i] = std::make_pair(code, i);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    for (int i = 0; i < n; i++)
+        order[i] = keys[i].second;
+}
+
+//Private.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::runQuery(const Query &q, std::vector<Point *> &buffer) const
+{
+    switch (q.type)
+    {
+        case Query::AT:
+            getContentAt(q.a, q.b, buffer);
+            break;
+        case Query::IN_RECT:
+            getContentInRect(q.a, q.b, q.c, q.d, buffer);
+            break;
+        case Query::IN_RADIUS:
+            getContentInRadius(q.a, q.b, q.c, buffer);
+            break;
+    }
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+std::vector<Point *> BasicQuadtree<Point, CoordAccessor>::nearest(float x, float y, int k) const
+{
+    std::vector<Point *> rVec;
+    nearest(x, y, k, rVec);
+
+    return rVec;
+}
+
+//Public.
+//Best first search. The nearest region in the queue is opened until it is farther away than
+//the k:th nearest point found, then no region left can have a nearer point.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::nearest(float x, float y, int k, std::vector<Point *> &buffer) const
+{
+    QUADTREE_TRACE(NEAREST, 0, 0, k);
+
+    buffer.clear();
+
+    QUADTREE_COUNT(C_QUERIES, 1);
+
+    if ( (k <= 0) || !m_root->getTotalLen() )
+        return;
+
+    std::vector<Candidate> regions;     //Heap with nearest first.
+    std::vector<Candidate> best;        //Heap with farthest first, at most k points.
+
+    Candidate root = { m_root->getSquaredDistance(x, y), m_root, 0 };
+    regions.push_back(root);
+
+    while ( !regions.empty() )
+    {
+        Candidate cur = regions.front();
+        std::pop_heap(regions.begin(), regions.end(), Candidate::farther);
+        regions.pop_back();
+
+        if ( (static_cast<int>(best.size()) == k) && (cur.dist >= best.front().dist) )
+            break;
+
+        QUADTREE_COUNT(C_NODES_VISITED, 1);
+
+        if ( cur.node->hasChildren() )
+        {
+            for (int e = Node::START_CHILD;
+                 e <= Node::END_CHILD;
+                 e++)
+            {
+                Node *curChild = cur.node->getChild(e);
+                if ( curChild->getTotalLen() ) //Empty subtrees have nothing to return.
+                {
+                    Candidate child = { curChild->getSquaredDistance(x, y), curChild, 0 };
+                    regions.push_back(child);
+                    std::push_heap(regions.begin(), regions.end(), Candidate::farther);
+                }
+            }
+        }
+        else
+        {
+            Point       **data = cur.node->getValues();
+            const float  *xs   = cur.node->getXs();
+            const float  *ys   = cur.node->getYs();
+
+            for (int i = 0; i < cur.node->getLen(); i++)
+            {
+                Candidate point = { (xs[i] - x) * (xs[i] - x) + (ys[i] - y) * (ys[i] - y), 0, data[i] };
+
+                if (static_cast<int>(best.size()) < k)
+                {
+                    best.push_back(point);
+                    std::push_heap(best.begin(), best.end(), Candidate::nearer);
+                }
+                else if (point.dist < best.front().dist)
+                {
+                    std::pop_heap(best.begin(), best.end(), Candidate::nearer);
+                    best.back() = point;
+                    std::push_heap(best.begin(), best.end(), Candidate::nearer);
+                }
+            }
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end(), Candidate::nearer);
+
+    for (size_t i = 0; i < best.size(); i++)
+        buffer.push_back(best[i].point);
+}
+
+//Public.
+//The leaf data is counted by capacity, the nodes by the slabs of the pool.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Stats BasicQuadtree<Point, CoordAccessor>::getStats() const
+{
+    Stats stats;
+
+    stats.nodes  = 0;
+    stats.leaves = 0;
+    stats.points = m_root->getTotalLen();
+    stats.depths.assign(m_maxDepth - static_cast<int>( m_root->getDepth() ) + 1, 0);
+    stats.occupancy.assign(m_bucketSize + 2, 0);
+    stats.bytes  = sizeof(*this) + sizeof(Node) + sizeof(Pool) + m_pool->getBytes();
+
+    if (m_index)
+        stats.bytes += sizeof(Index) + m_index->getBytes();
+
+    gatherStats(m_root, stats);
+
+    stats.emptyLeafRatio = stats.leaves ? static_cast<double>(stats.occupancy[0]) / stats.leaves : 0.0;
+
+    return stats;
+}
+
+//Private.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::gatherStats(Node *node, Stats &stats) const
+{
+    stats.nodes++;
+    stats.depths[ static_cast<int>( node->getDepth() - m_root->getDepth() ) ]++;
+
+    if ( node->hasChildren() )
+    {
+        for (int e = Node::START_CHILD;
+             e <= Node::END_CHILD;
+             e++)
+        {
+            gatherStats(node->getChild(e), stats);
+        }
+    }
+    else
+    {
+        stats.leaves++;
+        stats.occupancy[ std::min(node->getLen(), m_bucketSize + 1) ]++;
+        if ( node->getCapacity() )  //The capacity is stored in front of the data.
+            stats.bytes += sizeof(Point *) + node->getCapacity() * (sizeof(Point *) + 2 * sizeof(float));
+    }
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+typename BasicQuadtree<Point, CoordAccessor>::Counters BasicQuadtree<Point, CoordAccessor>::getCounters() const
+{
+    Counters counters = { m_counters[C_SUBDIVIDES].load(std::memory_order_relaxed),
+                          m_counters[C_MERGES].load(std::memory_order_relaxed),
+                          m_counters[C_FIND_FALLBACKS].load(std::memory_order_relaxed),
+                          m_counters[C_LEAF_REALLOCS].load(std::memory_order_relaxed),
+                          m_counters[C_QUERIES].load(std::memory_order_relaxed),
+                          m_counters[C_NODES_VISITED].load(std::memory_order_relaxed) };
+
+    return counters;
+}
+
+//Public.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::resetCounters()
+{
+    for (int i = 0; i < N_COUNTERS; i++)
+        m_counters[i].store(0, std::memory_order_relaxed);
+}
+
+//Public.
+//The records are gathered in memory first, then written in one pass.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::save(const char *path, IdGetter &getter) const
+{
+    QUADTREE_ASSERT( !m_batch );
+
+    QuadtreeSnapshot_content content;
+
+    content.nodes.resize(1);
+    content.xs.reserve( m_root->getTotalLen() );
+    content.ys.reserve( m_root->getTotalLen() );
+    content.ids.reserve( m_root->getTotalLen() );
+
+    saveNode(m_root, 0, content, getter);
+
+    QuadtreeSnapshot::write(path, m_root->getLeft(), m_root->getWidth(), m_root->getDown(),
+                            m_root->getHeigth(), m_maxDepth,
+                            (m_index ? OPT_INDEX : OPT_NONE) | (m_compressed ? OPT_COMPRESS : OPT_NONE),
+                            content);
+}
+
+//Private.
+//The children of a node are reserved as one block before any of them is written (depth first),
+//and the leaves append their points in the same order, so every subtree is one range of points.
+template <class Point, class CoordAccessor>
+void BasicQuadtree<Point, CoordAccessor>::saveNode(Node *node, int i, QuadtreeSnapshot_content &content,
+                                                   IdGetter &getter) const
+{
+    QuadtreeSnapshot_node record = { node->getLeft(), node->getDown(), node->getWidth(), node->getHeigth(),
+                                     -1, static_cast<uint32_t>( content.ids.size() ), 0,
+                                     static_cast<int32_t>( node->getDepth() ) };
+
+    if ( node->hasChildren() )
+    {
+        record.child = static_cast<int32_t>( content.nodes.size() );
+        content.nodes.resize(content.nodes.size() + 4);
+
+        for (int e = Node::START_CHILD;
+             e <= Node::END_CHILD;
+             e++)
+        {
+            saveNode(node->getChild(e), record.child + e, content, getter);
+        }
+    }
+    else
+    {
+        for (int j = 0; j < node->getLen(); j++)
+        {
+            content.xs.push_back( node->getXs()[j] );
+            content.ys.push_back( node->getYs()[j] );
+            content.ids.push_back( getter.getId(*node->getValues()[j]) );
+        }
+    }
+
+    record.end = static_cast<uint32_t>( content.ids.size() );
+    content.nodes[i] = record;  //Not a reference kept over the recursion, the vector grows.
+}
+
+template <class Point, class CoordAccessor>
+BasicQuadtree<Point, CoordAccessor>::NearestSearch::NearestSearch(const BasicQuadtree &tree, float x, float y)
+:   m_x(x), m_y(y), m_lastDist(0.0f)
+{
+    if ( tree.m_root->getTotalLen() )
+    {
+        Candidate root = { tree.m_root->getSquaredDistance(x, y), tree.m_root, 0 };
+        m_queue.push_back(root);
+    }
+}
+
+//Regions and points share one queue. A point reaching the front is nearer than every region
+//left, so no point not yet queued can be nearer.
+template <class Point, class CoordAccessor>
+Point *BasicQuadtree<Point, CoordAccessor>::NearestSearch::next()
+{
+    while ( !m_queue.empty() )
+    {
+        Candidate cur = m_queue.front();
+        std::pop_heap(m_queue.begin(), m_queue.end(), Candidate::farther);
+        m_queue.pop_back();
+
+        if ( !cur.node )
+        {
+            m_lastDist = cur.dist;
+            return cur.point;
+        }
+
+        if ( cur.node->hasChildren() )
+        {
+            for (int e = Node::START_CHILD;
+                 e <= Node::END_CHILD;
+                 e++)
+            {
+                Node *curChild = cur.node->getChild(e);
+                if ( curChild->getTotalLen() )
+                {
+                    Candidate child = { curChild->getSquaredDistance(m_x, m_y), curChild, 0 };
+                    m_queue.push_back(child);
+                    std::push_heap(m_queue.begin(), m_queue.end(), Candidate::farther);
+                }
+            }
+        }
+        else
+        {
+            Point       **data = cur.node->getValues();
+            const float  *xs   = cur.node->getXs();
+            const float  *ys   = cur.node->getYs();
+
+            for (int i = 0; i < cur.node->getLen(); i++)
+            {
+                Candidate point = { (xs[i] - m_x) * (xs[i] - m_x) + (ys[i] - m_y) * (ys[i] - m_y), 0, data[i] };
+                m_queue.push_back(point);
+                std::push_heap(m_queue.begin(), m_queue.end(), Candidate::farther);
+            }
+        }
+    }
+
+    return 0; //All points handed out.
+}
+
+template <class Point, class CoordAccessor>
+std::ostream &operator<<(std::ostream &out, const Quadtree_node<Point, CoordAccessor> &node)
+{
+    //Indented by depth below the root, the root of a grown tree is below depth zero.
+    const Quadtree_node<Point, CoordAccessor> *root = &node;
+    while ( root->getParent() )
+        root = root->getParent();
+
+    std::string tabber;
+    for (int i = root->depth; i < node.depth; i++)
+        tabber += "\t";
+
+    out << tabber << "[" << std::endl
+        << tabber << " " << &node << std::endl
+        << tabber << " left   = " << node.left << std::endl
+        << tabber << " width  = " << node.width <<  std::endl
+        << tabber << " down   = " << node.down << std::endl
+        << tabber << " height = " << node.height;
+
+    if (node.isLeaf)
+    {
+        if (node.len)
+        {
+            out << std::endl << tabber << " -- ";
+
+            const float *xs = node.getXs(), *ys = node.getYs();
+
+            for (int i = 0; i < node.len - 1; i++)
+            {
+                out << "(" << xs[i] << ", "
+                    << ys[i] << "), ";
+            }
+            out << "(" << xs[node.len - 1] << ", "
+                << ys[node.len - 1] << ")" << "-- " << std::endl
+                << tabber << "]" << std::endl;
+        }
+        else
+        {
+            out << std::endl << tabber << " --no content--" << std::endl
+                             << tabber << "]" << std::endl;
+        }
+    }
+    else
+    {
+        out << std::endl << tabber << "]" << std::endl;
+        for (int e = Quadtree_node<Point, CoordAccessor>::START_CHILD;
+             e <= Quadtree_node<Point, CoordAccessor>::END_CHILD;
+             e++)
+        {
+            out << *node.getChild(e);
+        }
+    }
+    return out;
+}
+
+template <class Point, class CoordAccessor>
+std::ostream &operator<<(std::ostream &out, const BasicQuadtree<Point, CoordAccessor> &tree)
+{
+    out << std::endl << *tree.m_root << std::endl;
+    return out;
+}
+
+#endif
@@ -0,0 +1,323 @@
+/** \file QuadtreeSnapshot.cpp
+ *  \brief Defining the read-only tree loaded from a snapshot file.
+ *
+ * File containing definition of \link QuadtreeSnapshot \endlink.
+ */
+
+#include "QuadtreeSnapshot.h"
+#include "QuadtreeImpl.h" //Rectangle filter.
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+const uint32_t QuadtreeSnapshot::VERSION;
+
+static const char     SNAPSHOT_MAGIC[8]    = { 'P', 'R', 'Q', 'T', 'S', 'N', 'A', 'P' };
+static const uint32_t SNAPSHOT_BYTE_ORDER  = 0x01020304;
+
+//Arrays start at multiples of 8 bytes, so the ids are aligned when mapped.
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+//Checks that an array lies inside the file and is aligned for its type.
+static bool isInFile(uint64_t offset, uint64_t count, uint64_t itemSize, uint64_t size)
+{
+    return (offset % 8 == 0) && (offset <= size) && (count <= (size - offset) / itemSize);
+}
+
+//Checks the links of the node records, so no query reads outside the arrays.
+//Children come after their parent, which also keeps a descent from looping.
+static bool isValidTree(const QuadtreeSnapshot_node *nodes, uint32_t nNodes, uint32_t nPoints)
+{
+    for (uint32_t i = 0; i < nNodes; i++)
+    {
+        int64_t child = nodes[i].child;
+
+        if ( (child != -1) && ( (child <= static_cast<int64_t>(i)) || (child + 4 > static_cast<int64_t>(nNodes)) ) )
+            return false;
+        if ( (nodes[i].begin > nodes[i].end) || (nodes[i].end > nPoints) )
+            return false;
+    }
+
+    return true;
+}
+
+//Public.
+//The whole file is mapped read only, the header and node records are checked here.
+QuadtreeSnapshot::QuadtreeSnapshot(const char *path)
+:   m_data(0), m_size(0)
+{
+#   ifdef _WIN32
+        m_mapping = 0;
+
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, 0);
+        if (file == INVALID_HANDLE_VALUE)
+            throw QuadtreeException::QE_badFile;
+
+        LARGE_INTEGER size;
+        if ( GetFileSizeEx(file, &size) && size.QuadPart )
+        {
+            m_size    = static_cast<uint64_t>(size.QuadPart);
+            m_mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+            if (m_mapping)
+                m_data = static_cast<const char *>( MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) );
+        }
+        CloseHandle(file);  //The mapping keeps the file open.
+#   else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            throw QuadtreeException::QE_badFile;
+
+        struct stat st;
+        if ( (fstat(fd, &st) == 0) && (st.st_size > 0) )
+        {
+            m_size = static_cast<uint64_t>(st.st_size);
+
+            void *data = mmap(0, m_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+                m_data = static_cast<const char *>(data);
+        }
+        close(fd);          //The mapping keeps the file open.
+#   endif
+
+    m_header = reinterpret_cast<const QuadtreeSnapshot_header *>(m_data);
+
+    if ( !m_data || (m_size < sizeof(QuadtreeSnapshot_header)) ||
+         (std::memcmp(m_header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) ||
+         (m_header->version != VERSION) || (m_header->byteOrder != SNAPSHOT_BYTE_ORDER) ||
+         (m_header->nNodes == 0) ||
+         !isInFile(m_header->nodesOffset, m_header->nNodes,  sizeof(QuadtreeSnapshot_node), m_size) ||
+         !isInFile(m_header->xsOffset,    m_header->nPoints, sizeof(float),    m_size) ||
+         !isInFile(m_header->ysOffset,    m_header->nPoints, sizeof(float),    m_size) ||
+         !isInFile(m_header->idsOffset,   m_header->nPoints, sizeof(uint64_t), m_size) )
+    {
+        unmap();
+        throw QuadtreeException::QE_badFile;
+    }
+
+    m_nodes = reinterpret_cast<const QuadtreeSnapshot_node *>(m_data + m_header->nodesOffset);
+    m_xs    = reinterpret_cast<const float *>(m_data + m_header->xsOffset);
+    m_ys    = reinterpret_cast<const float *>(m_data + m_header->ysOffset);
+    m_ids   = reinterpret_cast<const uint64_t *>(m_data + m_header->idsOffset);
+
+    if ( !isValidTree(m_nodes, m_header->nNodes, m_header->nPoints) )
+    {
+        unmap();
+        throw QuadtreeException::QE_badFile;
+    }
+}
+
+QuadtreeSnapshot::~QuadtreeSnapshot()
+{
+    unmap();
+}
+
+//Private.
+void QuadtreeSnapshot::unmap()
+{
+#   ifdef _WIN32
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        m_mapping = 0;
+#   else
+        if (m_data)
+            munmap(const_cast<char *>(m_data), m_size);
+#   endif
+    m_data = 0;
+}
+
+//Public.
+//The arrays are written in the order of the header, each padded to 8 bytes.
+void QuadtreeSnapshot::write(const char *path, float left, float width, float down, float height,
+                             int maxDepth, int flags, const QuadtreeSnapshot_content &content)
+{
+    QuadtreeSnapshot_header header;
+    std::memset(&header, 0, sizeof(header));
+
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version     = VERSION;
+    header.byteOrder   = SNAPSHOT_BYTE_ORDER;
+    header.left        = left;
+    header.width       = width;
+    header.down        = down;
+    header.height      = height;
+    header.maxDepth    = maxDepth;
+    header.flags       = flags;
+    header.nNodes      = static_cast<uint32_t>( content.nodes.size() );
+    header.nPoints     = static_cast<uint32_t>( content.ids.size() );
+    header.nodesOffset = alignUp( sizeof(header) );
+    header.xsOffset    = alignUp( header.nodesOffset + header.nNodes * sizeof(QuadtreeSnapshot_node) );
+    header.ysOffset    = alignUp( header.xsOffset  + header.nPoints * sizeof(float) );
+    header.idsOffset   = alignUp( header.ysOffset  + header.nPoints * sizeof(float) );
+
+    std::FILE *file = std::fopen(path, "wb");
+    if (!file)
+        throw QuadtreeException::QE_badFile;
+
+    static const char padding[8] = { 0 };
+    const uint64_t    offsets[]  = { header.nodesOffset, header.xsOffset, header.ysOffset, header.idsOffset };
+    const void       *arrays[]   = { content.nodes.empty() ? 0 : &content.nodes[0],
+                                     content.xs.empty()    ? 0 : &content.xs[0],
+                                     content.ys.empty()    ? 0 : &content.ys[0],
+                                     content.ids.empty()   ? 0 : &content.ids[0] };
+    const uint64_t    sizes[]    = { header.nNodes  * sizeof(QuadtreeSnapshot_node),
+                                     header.nPoints * sizeof(float),
+                                     header.nPoints * sizeof(float),
+                                     header.nPoints * sizeof(uint64_t) };
+
+    bool     ok  = ( std::fwrite(&header, sizeof(header), 1, file) == 1 );
+    uint64_t pos = sizeof(header);
+
+    for (int i = 0; ok && (i < 4); i++)
+    {
+        ok  = ( std::fwrite(padding, 1, offsets[i] - pos, file) == offsets[i] - pos );
+        ok  = ok && ( std::fwrite(arrays[i], 1, sizes[i], file) == sizes[i] );
+        pos = offsets[i] + sizes[i];
+    }
+
+    if ( (std::fclose(file) != 0) || !ok )
+        throw QuadtreeException::QE_badFile;
+}
+
+/**
+ * Visitor appending the ids to a vector.
+ */
+struct QuadtreeSnapshot_bufferVisitor : public QuadtreeSnapshot::Visitor
+{
+    explicit QuadtreeSnapshot_bufferVisitor(std::vector<uint64_t> &b) : buffer(b) {}
+
+    void visit(const uint64_t *ids, const float *, const float *, int n)
+    { buffer.insert(buffer.end(), ids, ids + n); }
+
+    std::vector<uint64_t> &buffer;
+};
+
+//Public.
+std::vector<uint64_t> QuadtreeSnapshot::getContentAt(float x, float y) const
+{
+    std::vector<uint64_t> rVec;
+    QuadtreeSnapshot_bufferVisitor visitor(rVec);
+
+    getContentAt(x, y, visitor);
+
+    return rVec;
+}
+
+//Public.
+//Descends like BasicQuadtree::getLeafAt. In a compressed tree no child may hold the location.
+void QuadtreeSnapshot::getContentAt(float x, float y, Visitor &visitor) const
+{
+    const QuadtreeSnapshot_node *curNode = m_nodes;
+
+    if ( !( (x >= curNode->left) && (x < curNode->left + curNode->width) &&
+            (y >= curNode->down) && (y < curNode->down + curNode->height) ) )
+        throw QuadtreeException::QE_outOfBound;
+
+    while (curNode->child >= 0)
+    {
+        const QuadtreeSnapshot_node *children = m_nodes + curNode->child;
+        const QuadtreeSnapshot_node *next     = 0;
+
+        for (int e = 0; e < 4; e++)
+        {
+            if ( (x >= children[e].left) && (x < children[e].left + children[e].width) &&
+                 (y >= children[e].down) && (y < children[e].down + children[e].height) )
+            {
+                next = &children[e];
+                break;
+            }
+        }
+
+        if (!next)
+            return; //Outside the region of a shrunk node, there are no points.
+
+        curNode = next;
+    }
+
+    if (curNode->end > curNode->begin)
+        visitor.visit(m_ids + curNode->begin, m_xs + curNode->begin, m_ys + curNode->begin,
+                      curNode->end - curNode->begin);
+}
+
+//Public.
+std::vector<uint64_t> QuadtreeSnapshot::getContentInRect(float left, float down, float right, float up) const
+{
+    std::vector<uint64_t> rVec;
+    QuadtreeSnapshot_bufferVisitor visitor(rVec);
+
+    getContentInRect(left, down, right, up, visitor);
+
+    return rVec;
+}
+
+//Public.
+void QuadtreeSnapshot::getContentInRect(float left, float down, float right, float up, Visitor &visitor) const
+{
+    if ( (left > right) || (down > up) )
+        throw QuadtreeException::QE_badRect;
+
+    visitInRect(0, left, down, right, up, visitor);
+}
+
+//Private.
+//Same pruning as BasicQuadtree::visitInRect, a subtree completely inside is one range of the arrays.
+void QuadtreeSnapshot::visitInRect(int i, float left, float down, float right, float up, Visitor &visitor) const
+{
+    const QuadtreeSnapshot_node &node = m_nodes[i];
+
+    if ( (node.left >= left) && (node.left + node.width <= right) &&
+         (node.down >= down) && (node.down + node.height <= up) )
+    {
+        if (node.end > node.begin)
+            visitor.visit(m_ids + node.begin, m_xs + node.begin, m_ys + node.begin, node.end - node.begin);
+    }
+    else if (node.child >= 0)
+    {
+        for (int e = 0; e < 4; e++)
+        {
+            const QuadtreeSnapshot_node &curChild = m_nodes[node.child + e];
+            if ( (curChild.end > curChild.begin) &&
+                 (curChild.left <= right) && (curChild.left + curChild.width > left) &&
+                 (curChild.down <= up)    && (curChild.down + curChild.height > down) )
+            {
+                visitInRect(node.child + e, left, down, right, up, visitor);
+            }
+        }
+    }
+    else
+    {
+        int      idx[QUADTREE_FILTER_CHUNK];
+        uint64_t ids[QUADTREE_FILTER_CHUNK];
+        float    xs[QUADTREE_FILTER_CHUNK], ys[QUADTREE_FILTER_CHUNK];
+
+        for (uint32_t j = node.begin; j < node.end; j += QUADTREE_FILTER_CHUNK)
+        {
+            int n = node.end - j < QUADTREE_FILTER_CHUNK ? node.end - j : QUADTREE_FILTER_CHUNK;
+            int k = Quadtree_filterRect(m_xs + j, m_ys + j, n, left, down, right, up, idx);
+
+            for (int l = 0; l < k; l++)
+            {
+                ids[l] = m_ids[j + idx[l]];
+                xs[l]  = m_xs[j + idx[l]];
+                ys[l]  = m_ys[j + idx[l]];
+            }
+
+            if (k)
+                visitor.visit(ids, xs, ys, k);
+        }
+    }
+}
@@ -0,0 +1,219 @@
+/** \file QuadtreeSnapshot.h
+ *  \brief Declaring the on-disk format of a tree and the read-only tree loaded from it.
+ *
+ * File containing declaration of \link QuadtreeSnapshot \endlink and the records of its file format.
+ * A snapshot is written by \link BasicQuadtree::save \endlink.
+ */
+
+#ifndef QUADTREE_SNAPSHOT_H
+#define QUADTREE_SNAPSHOT_H
+
+#include "Quadtree.h" //QuadtreeException is shared with the pointer tree.
+
+#include <stdint.h>   //The records have the same size on every platform.
+#include <vector>
+
+/**
+ * Header at the start of a snapshot file.
+ * The file is written in the byte order of the machine writing it, a file of another
+ * byte order is rejected when opened. The arrays are aligned to 8 bytes in the file.
+ */
+struct QuadtreeSnapshot_header
+{
+    char     magic[8];                  //"PRQTSNAP".
+    uint32_t version;                   //QuadtreeSnapshot::VERSION when written.
+    uint32_t byteOrder;                 //0x01020304 as written.
+    float    left, width, down, height; //Scene, region of the root.
+    int32_t  maxDepth;
+    uint32_t flags;                     //Options of the tree saved, BasicQuadtree::OPT_ constants.
+    uint32_t nNodes;
+    uint32_t nPoints;
+    uint64_t nodesOffset;               //Offsets from the start of the file.
+    uint64_t xsOffset;
+    uint64_t ysOffset;
+    uint64_t idsOffset;
+};
+
+/**
+ * Node record of a snapshot file.
+ * Node 0 is the root. The four children of an interleaf are consecutive records, in
+ * NE, NW, SW, SE order. The points of every subtree are one consecutive range of the
+ * point arrays, so a subtree completely inside a query is read without descending.
+ */
+struct QuadtreeSnapshot_node
+{
+    float    left, down, width, height; //Region, can be shrunk in a compressed tree.
+    int32_t  child;                     //Record of first child, -1 for a leaf.
+    uint32_t begin, end;                //Points of subtree.
+    int32_t  depth;
+};
+
+/**
+ * Content of a tree gathered by \link BasicQuadtree::save \endlink, in file order.
+ */
+struct QuadtreeSnapshot_content
+{
+    std::vector<QuadtreeSnapshot_node> nodes;
+    std::vector<float>                 xs, ys;  //Coordinates copied by the leaves.
+    std::vector<uint64_t>              ids;     //User ids of the points.
+};
+
+/** \class QuadtreeSnapshot
+ *  \brief Read-only tree mapped from a snapshot file.
+ *
+ * The file is mapped into memory and queried where it lies, nothing is read or
+ * built when it is opened, so opening costs the same for any size of tree. Processes
+ * opening the same file share its pages. The points are returned by their user ids.
+ *
+ * The header is checked when opened, the records are trusted to be the ones written
+ * by \link BasicQuadtree::save \endlink.
+ */
+class QuadtreeSnapshot
+{
+    public:
+        /**
+         * Version of the file format written, files of other versions are rejected.
+         */
+        static const uint32_t VERSION = 1;
+
+        /**
+         * Opens and maps a snapshot file.
+         * Will throw \link QuadtreeException::QE_badFile \endlink if the file can't be
+         * mapped, is not a snapshot of this version and byte order, or its node records
+         * link outside the file.
+         *
+         * @param path Path of file.
+         */
+        explicit QuadtreeSnapshot(const char *);
+        /**
+         * Destructor.
+         * Unmaps the file.
+         */
+        ~QuadtreeSnapshot();
+
+        /**
+         * Writes a snapshot file.
+         * Will throw \link QuadtreeException::QE_badFile \endlink if the file can't be written.
+         *
+         * @param path     Path of file, overwritten.
+         * @param left     Left x-coordinate of scene.
+         * @param width    Width of scene.
+         * @param down     Down y-coordinate of scene.
+         * @param height   Height of scene.
+         * @param maxDepth Max depth of the tree.
+         * @param flags    Options of the tree.
+         * @param content  Nodes and points of the tree.
+         */
+        static void write(const char *, float, float, float, float, int, int,
+                          const QuadtreeSnapshot_content &);
+
+        /** \class Visitor
+         *  \brief Receiver of the points found by a query.
+         *
+         * Points of regions completely inside a query are handed over straight from the file.
+         */
+        class Visitor
+        {
+            public:
+                virtual ~Visitor() {}
+
+                /**
+                 * Receives a batch of points found by a query.
+                 * The arrays are only valid during the call.
+                 *
+                 * @param ids Ids of points found.
+                 * @param xs  X-coordinates of points.
+                 * @param ys  Y-coordinates of points.
+                 * @param n   Number of points, always positive.
+                 */
+                virtual void visit(const uint64_t *, const float *, const float *, int) = 0;
+        };
+
+        /**
+         * Returning content in smalles region containing the point, as
+         * \link BasicQuadtree::getContentAt \endlink of the tree saved.
+         *
+         * @param x X-coordinate.
+         * @param y Y-coordinate.
+         * @return  The ids of the content at the smallest subregion of point.
+         */
+        std::vector<uint64_t> getContentAt(float, float)                             const;
+        /**
+         * Visits the content in smallest region containing the point.
+         *
+         * @param x       X-coordinate.
+         * @param y       Y-coordinate.
+         * @param visitor Receives the content.
+         */
+        void getContentAt(float, float, Visitor &)                                   const;
+
+        /**
+         * Returning content in a rectangular area.
+         *
+         * @param left  Left x-coordinate of rectangle.
+         * @param down  Down y-coordinate of rectangle.
+         * @param right Right x-coordinate of rectangle.
+         * @param up    Up y-coordinate of rectangle.
+         * @return      The ids of the content inside the rectangle.
+         */
+        std::vector<uint64_t> getContentInRect(float, float, float, float)           const;
+        /**
+         * Visits the content in a rectangular area.
+         *
+         * @param left    Left x-coordinate of rectangle.
+         * @param down    Down y-coordinate of rectangle.
+         * @param right   Right x-coordinate of rectangle.
+         * @param up      Up y-coordinate of rectangle.
+         * @param visitor Receives the content.
+         */
+        void getContentInRect(float, float, float, float, Visitor &)                 const;
+
+        /**
+         * @return Number of points in the snapshot.
+         */
+        int getSize()  const { return static_cast<int>(m_header->nPoints); }
+        /**
+         * @return Max depth of the tree saved.
+         */
+        int getMaxDepth() const { return m_header->maxDepth; }
+
+    private:
+        QuadtreeSnapshot(const QuadtreeSnapshot &);             //Not copyable, owns the mapping.
+        QuadtreeSnapshot &operator=(const QuadtreeSnapshot &);
+
+        /**
+         * Unmaps the file, if mapped.
+         */
+        void unmap();
+        /**
+         * Visits the content of a subtree in a rectangular area.
+         *
+         * @param i       Record of root of subtree, at least partly inside rectangle.
+         * @param left    Left x-coordinate of rectangle.
+         * @param down    Down y-coordinate of rectangle.
+         * @param right   Right x-coordinate of rectangle.
+         * @param up      Up y-coordinate of rectangle.
+         * @param visitor Receives the content.
+         */
+        void visitInRect(int, float, float, float, float, Visitor &) const;
+
+        /**
+         * Mapped file.
+         */
+        const char                    *m_data;
+        uint64_t                       m_size;
+#       ifdef _WIN32
+            void                      *m_mapping;   //Handle of the mapping object.
+#       endif
+
+        /**
+         * Parts of the mapped file.
+         */
+        const QuadtreeSnapshot_header *m_header;
+        const QuadtreeSnapshot_node   *m_nodes;
+        const float                   *m_xs;
+        const float                   *m_ys;
+        const uint64_t                *m_ids;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/** \file QuadtreeTrace.cpp
+ *  \brief Defining the binary event tracing of the trees.
+ *
+ * File containing definition of \link QuadtreeTrace \endlink.
+ *
+ * Trace file: the magic "PRQTTRC1", then for every thread its number and event count
+ * (two uint32_t) followed by its events (\link QuadtreeTrace_event \endlink), oldest first.
+ */
+
+#include "QuadtreeTrace.h"
+
+#include <cstdio>
+#include <vector>
+
+const int QuadtreeTrace::RING_SIZE;
+
+thread_local QuadtreeTrace::Ring *QuadtreeTrace::t_ring = 0;
+std::atomic<QuadtreeTrace::Ring *> QuadtreeTrace::s_rings(0);
+
+//Private.
+//The rings are never freed, so the events of finished threads can still be dumped.
+QuadtreeTrace::Ring *QuadtreeTrace::addRing()
+{
+    static std::atomic<uint32_t> threads(0);
+
+    Ring *ring = new Ring;
+    ring->thread = threads.fetch_add(1, std::memory_order_relaxed);
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->next   = s_rings.load(std::memory_order_relaxed);
+
+    while ( !s_rings.compare_exchange_weak(ring->next, ring, std::memory_order_release,
+                                           std::memory_order_relaxed) )
+    {
+        //ring->next has been reloaded by the failed exchange.
+    }
+
+    t_ring = ring;
+    return ring;
+}
+
+//Public.
+//The head is read before and after copying a ring, events the writer may have overwritten
+//in between are dropped.
+bool QuadtreeTrace::dump(const char *path)
+{
+    std::FILE *file = std::fopen(path, "wb");
+    if (!file)
+        return false;
+
+    bool ok = ( std::fwrite("PRQTTRC1", 1, 8, file) == 8 );
+
+    std::vector<QuadtreeTrace_event> events(RING_SIZE);
+
+    for (Ring *ring = s_rings.load(std::memory_order_acquire); ok && ring; ring = ring->next)
+    {
+        uint64_t end   = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = (end > RING_SIZE) ? end - RING_SIZE : 0;
+
+        for (uint64_t i = begin; i < end; i++)
+            events[i - begin] = ring->events[i & (RING_SIZE - 1)];
+
+        std::atomic_thread_fence(std::memory_order_acquire); //The copy is done before the head is read again.
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        //Oldest event not overwritten. The writer of event head may be half way through its slot,
+        //which still holds event head - RING_SIZE.
+        uint64_t kept = (head >= RING_SIZE) ? head - RING_SIZE + 1 : 0;
+        uint64_t skip = (kept > begin) ? kept - begin : 0;
+
+        uint32_t record[2] = { ring->thread, static_cast<uint32_t>( (end > begin + skip) ? end - begin - skip : 0 ) };
+
+        ok = ( std::fwrite(record, sizeof(record), 1, file) == 1 );
+        if (ok && record[1])
+            ok = ( std::fwrite(&events[skip], sizeof(QuadtreeTrace_event), record[1], file) == record[1] );
+    }
+
+    return (std::fclose(file) == 0) && ok;
+}
+
+//Public.
+const char *QuadtreeTrace::getName(int op)
+{
+    static const char *names[N_OPS] =
+    {
+        "createNode", "destroyNode", "addValue", "removeValue", "subdivide", "merge", "shrink", "pushDown",
+        "collapse", "build", "getLeafAt", "find", "addPos", "removePos", "updatePos", "commit", "getContentAt",
+        "getContentInRect", "getContentInRadius", "nearest", "grow"
+    };
+
+    return ( (op >= 0) && (op < N_OPS) ) ? names[op] : "unknown";
+}
@@ -0,0 +1,127 @@
+/** \file QuadtreeTrace.h
+ *  \brief Declaring the binary event tracing of the trees.
+ *
+ * File containing declaration of \link QuadtreeTrace \endlink and the
+ * \link QUADTREE_TRACE \endlink macro used by the trees.
+ *
+ * Tracing is compiled in when QUADTREE_TRACING is defined (debug builds define it), otherwise
+ * the macro expands to nothing. The events are dumped to a binary file by \link QuadtreeTrace::dump \endlink,
+ * traceDump.cpp converts the file to a Chrome trace (Perfetto) JSON timeline.
+ */
+
+#ifndef QUADTREE_TRACE_H
+#define QUADTREE_TRACE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+/**
+ * Event of the trace file, 24 bytes.
+ */
+struct QuadtreeTrace_event
+{
+    uint64_t time;      //Nanoseconds of the steady clock.
+    uint64_t node;      //Address of the node, 0 for operations of the whole tree.
+    uint32_t arg;       //Number of points, or argument of the operation.
+    uint16_t op;        //QuadtreeTrace::Op.
+    int16_t  depth;     //Depth of the node.
+};
+
+/** \class QuadtreeTrace
+ *  \brief Per thread ring buffers of binary events.
+ *
+ * Every thread recording an event gets its own ring on its first event, so recording takes
+ * no lock and shares no cache line with other threads. A full ring overwrites its oldest
+ * events. The rings are linked into a list that is only ever pushed to, with a compare and swap.
+ */
+class QuadtreeTrace
+{
+    public:
+        /**
+         * Operations traced.
+         */
+        enum Op
+        {
+            CREATE_NODE, DESTROY_NODE, ADD_VALUE, REMOVE_VALUE, SUBDIVIDE, MERGE, SHRINK, PUSH_DOWN,
+            COLLAPSE, BUILD, GET_LEAF, FIND, ADD_POS, REMOVE_POS, UPDATE_POS, COMMIT, GET_AT,
+            GET_IN_RECT, GET_IN_RADIUS, NEAREST, GROW,
+            N_OPS
+        };
+
+        static const int RING_SIZE = 1 << 16; ///< Events kept per thread, a power of two.
+
+        /**
+         * Records an event in the ring of the calling thread.
+         *
+         * @param op    Operation, \link Op \endlink.
+         * @param node  Node of the operation, null (0) for the whole tree.
+         * @param depth Depth of the node.
+         * @param arg   Number of points, or argument of the operation.
+         */
+        static void record(int op, const void *node, int depth, unsigned arg)
+        {
+            Ring    *ring = t_ring ? t_ring : addRing();
+            uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+            QuadtreeTrace_event &event = ring->events[head & (RING_SIZE - 1)];
+            event.time  = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now().time_since_epoch() ).count();
+            event.node  = reinterpret_cast<uintptr_t>(node);
+            event.arg   = arg;
+            event.op    = static_cast<uint16_t>(op);
+            event.depth = static_cast<int16_t>(depth);
+
+            ring->head.store(head + 1, std::memory_order_release); //Publishes the event.
+        }
+
+        /**
+         * Writes the events of all threads to a binary trace file.
+         * Can be called while other threads record, events overwritten during the copy are left out.
+         *
+         * @param path Path of file, overwritten.
+         * @return     False if the file can't be written.
+         */
+        static bool dump(const char *);
+
+        /**
+         * Gets the name of an operation.
+         *
+         * @param op Operation, \link Op \endlink.
+         * @return   The name, "unknown" if not an operation.
+         */
+        static const char *getName(int);
+
+    private:
+        /**
+         * Events of one thread, written by that thread only.
+         */
+        struct Ring
+        {
+            Ring                 *next;
+            uint32_t              thread;   //Number of the thread, in order of first event.
+            std::atomic<uint64_t> head;     //Events recorded, the next is written at head % RING_SIZE.
+            QuadtreeTrace_event   events[RING_SIZE];
+        };
+
+        /**
+         * Creates the ring of the calling thread and links it into the list.
+         *
+         * @return The ring.
+         */
+        static Ring *addRing();
+
+        static thread_local Ring *t_ring;   ///< Ring of the calling thread, null (0) before its first event.
+        static std::atomic<Ring *> s_rings; ///< List of all rings.
+};
+
+/**
+ * Records a trace event, nothing is compiled without QUADTREE_TRACING.
+ */
+#ifdef QUADTREE_TRACING
+#   define QUADTREE_TRACE(op, node, depth, arg) QuadtreeTrace::record(QuadtreeTrace::op, node, depth, arg)
+#else
+#   define QUADTREE_TRACE(op, node, depth, arg)
+#endif
+
+#endif
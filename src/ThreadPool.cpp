@@ -0,0 +1,136 @@
+/** \file ThreadPool.cpp
+ *  \brief Defining the thread pool used for parallel work on a tree.
+ *
+ * File containing definition of \link ThreadPool \endlink.
+ */
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int nThreads)
+:   m_generation(0), m_active(0), m_stop(false), m_task(0), m_ctx(0),
+    m_ranges(new Range[nThreads > 1 ? nThreads : 1])
+{
+    for (int i = 1; i < nThreads; i++)
+        m_threads.push_back( std::thread(&ThreadPool::work, this, i) );
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); i++)
+        m_threads[i].join();
+
+    delete[] m_ranges;
+}
+
+//The tasks are dealt out in equal contiguous ranges before the workers are woken.
+void ThreadPool::run(Task task, void *ctx, int nTasks)
+{
+    int nThreads = getThreads();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = task;
+        m_ctx  = ctx;
+
+        for (int t = 0; t < nThreads; t++)
+        {
+            std::lock_guard<std::mutex> rangeLock(m_ranges[t].mutex);
+            m_ranges[t].begin = static_cast<int>( static_cast<long long>(nTasks) * t / nThreads );
+            m_ranges[t].end   = static_cast<int>( static_cast<long long>(nTasks) * (t + 1) / nThreads );
+        }
+
+        m_active = static_cast<int>(m_threads.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    execute(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_active)
+        m_done.wait(lock);
+}
+
+//Private.
+//Own tasks are taken from the front, so a thread runs its range in order.
+void ThreadPool::execute(int self)
+{
+    Range &own = m_ranges[self];
+
+    for (;;)
+    {
+        int i = -1;
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.begin < own.end)
+                i = own.begin++;
+        }
+
+        if (i >= 0)
+            m_task(m_ctx, i);
+        else if ( !steal(self) )
+            return;
+    }
+}
+
+//Private.
+//Steals from the back, away from where the victim is working. Never holds two locks at once.
+bool ThreadPool::steal(int self)
+{
+    int nThreads = getThreads();
+
+    for (int k = 1; k < nThreads; k++)
+    {
+        Range &victim = m_ranges[(self + k) % nThreads];
+        int begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            int n = victim.end - victim.begin;
+            if (n <= 0)
+                continue;
+
+            end   = victim.end;
+            begin = victim.end - (n + 1) / 2;
+            victim.end = begin;
+        }
+
+        std::lock_guard<std::mutex> lock(m_ranges[self].mutex);
+        m_ranges[self].begin = begin;
+        m_ranges[self].end   = end;
+        return true;
+    }
+
+    return false;
+}
+
+//Private.
+void ThreadPool::work(int self)
+{
+    unsigned seen = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while ( !m_stop && (m_generation == seen) )
+                m_wake.wait(lock);
+
+            if (m_stop)
+                return;
+
+            seen = m_generation;
+        }
+
+        execute(self);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ( --m_active == 0 )
+            m_done.notify_one();
+    }
+}
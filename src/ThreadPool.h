@@ -0,0 +1,109 @@
+/** \file ThreadPool.h
+ *  \brief Declaring the thread pool used for parallel work on a tree.
+ *
+ * File containing declaration of \link ThreadPool \endlink.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/** \class ThreadPool
+ *  \brief Fixed set of worker threads running indexed tasks.
+ *
+ * The threads are started once and sleep between calls to \link run \endlink.
+ * The tasks of a run are split into one contiguous range per thread, so neighbouring tasks
+ * run on the same thread. A thread that has run out of tasks steals the back half of the
+ * range of another thread (work stealing).
+ */
+class ThreadPool
+{
+    public:
+        /**
+         * Task function.
+         *
+         * @param ctx Context given to \link run \endlink.
+         * @param i   Index of the task, in range [0, nTasks).
+         */
+        typedef void (*Task)(void *, int);
+
+        /**
+         * Starts the threads.
+         *
+         * @param nThreads Number of threads running tasks, including the thread calling run.
+         */
+        explicit ThreadPool(int);
+        /**
+         * Stops and joins the threads.
+         */
+        ~ThreadPool();
+
+        /**
+         * Runs the tasks 0, ..., nTasks - 1 and returns when all are done.
+         * The calling thread runs tasks too. Tasks must not throw.
+         *
+         * @param task   Task function.
+         * @param ctx    Context passed to every task.
+         * @param nTasks Number of tasks.
+         */
+        void run(Task, void *, int);
+
+        /**
+         * @return Number of threads running tasks, including the thread calling run.
+         */
+        int getThreads() const { return static_cast<int>(m_threads.size()) + 1; }
+
+    private:
+        ThreadPool(const ThreadPool &);            //Not copyable.
+        ThreadPool &operator=(const ThreadPool &);
+
+        /**
+         * Body of the worker threads.
+         *
+         * @param self Index of the thread, the thread calling run is 0.
+         */
+        void work(int);
+        /**
+         * Runs tasks until all have been started, first from the own range, then stolen ones.
+         *
+         * @param self Index of the thread.
+         */
+        void execute(int);
+        /**
+         * Moves the back half of the range of another thread to the own range.
+         *
+         * @param self Index of the thread.
+         * @return     False if no thread had tasks left.
+         */
+        bool steal(int);
+
+        /**
+         * Tasks not yet started by one thread.
+         * Padded, so threads taking tasks from their own ranges do not share cache lines.
+         */
+        struct Range
+        {
+            std::mutex mutex;
+            int        begin, end;
+            char       pad[64];
+        };
+
+        std::vector<std::thread> m_threads;
+
+        std::mutex               m_mutex;
+        std::condition_variable  m_wake;        //Signalled when a run starts or the pool stops.
+        std::condition_variable  m_done;        //Signalled when the last worker finishes a run.
+        unsigned                 m_generation;  //Incremented for every run.
+        int                      m_active;      //Workers still in the current run.
+        bool                     m_stop;
+
+        Task                     m_task;
+        void                    *m_ctx;
+        Range                   *m_ranges;      //One per thread.
+};
+
+#endif
@@ -7,6 +7,9 @@
 #include "autoTest.h"
 
 #include "Quadtree.h"
+#include "QuadtreeSnapshot.h"
+#include "LinearQuadtree.h"
+#include "ThreadPool.h"
 
 #include <iostream>
 using namespace std;
@@ -14,6 +17,7 @@ using namespace std;
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
+#include <cstring>
 
 #define SQUARE(a)   ( (a)*(a) )
 
@@ -426,3 +430,759 @@ void testGetRect()
     cout << "----Test \"Get in rectangle\"---- END" << endl;
     PAUSE();
 }
+
+//Testing Quadtree::Quadtree(float, float, float, float, int, IRO_Point2D *const *, int).
+void testBuild()
+{
+    cout << "----Test \"Build\"---- BEGIN" << endl
+         << "\tTesting building a tree from an array of points." << endl << endl;
+    {
+        Vector2 pos1(-1, -1), pos2(0, 0), pos3(1, 1), pos4(1, 1);
+        IRO_Point2D *points[] = { &pos1, &pos2, &pos3, &pos4 };
+
+        PAUSE();
+        cout << "----> Test part 1: \"Adding points one by one\"" << endl
+             << "\tShould subdivide to max depth (=5) at (1, 1)." << endl;
+        PAUSE();
+
+        Quadtree addedTree(-10, 20, -10, 20, 5);
+        for (int i = 0; i < 4; i++)
+            addedTree.addPos(points[i]);
+
+        cout << addedTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Building from array\"" << endl
+             << "\tShould produce same output as \"Test part 1\" (but node addresses)." << endl;
+        PAUSE();
+
+        Quadtree builtTree(-10, 20, -10, 20, 5, points, 4);
+        cout << builtTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Trying to trigger exception\"" << endl
+             <<"\tShould throw QE_outOfBound exception when building with a point outside region." << endl;
+        PAUSE();
+
+        pos4 = Vector2(-100, -100);
+        try
+        {
+            Quadtree badTree(-10, 20, -10, 20, 5, points, 4);
+        }
+        catch (exception &e)
+        {
+            cout << e.what() << endl;
+        }
+    }
+    cout << "----Test \"Build\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing Quadtree::nearest(float, float, int) and Quadtree::NearestSearch.
+void testNearest()
+{
+    cout << "----Test \"Nearest\"---- BEGIN" << endl
+         << "\tTesting getting the points nearest to a location." << endl << endl;
+    {
+        vector<IRO_Point2D *> posVec;
+
+        Quadtree testTree(-10, 20, -10, 20, 5);
+        Vector2 pos1(-5, -5), pos2(0, 0), pos3(5, 5), pos4(6, 6);
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+        testTree.addPos(&pos3);
+        testTree.addPos(&pos4);
+
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 1: \"Get two nearest\"" << endl
+             << "\tShould return vectors (5, 5) and (6, 6)." << endl
+             << "\tGetting 2 nearest to (4, 4)" << endl;
+        PAUSE();
+
+        posVec = testTree.nearest(4, 4, 2);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Get more than stored, outside scene\"" << endl
+             << "\tShould return all vectors, (-5, -5) first." << endl
+             << "\tGetting 10 nearest to (-20, -20)" << endl;
+        PAUSE();
+
+        posVec = testTree.nearest(-20, -20, 10);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Incremental search\"" << endl
+             << "\tShould return vectors (0, 0), (-5, -5), (5, 5) and (6, 6) with their squared distances." << endl
+             << "\tSearching from (-1, -1)" << endl;
+        PAUSE();
+
+        Quadtree::NearestSearch search(testTree, -1, -1);
+
+        cout << "Content: \"";
+        for (IRO_Point2D *pos = search.next(); pos; pos = search.next())
+            cout << "(" << pos->getX() << ", " << pos->getY() << "): " << search.getSquaredDistance() << " ";
+        cout << "\"" << endl;
+    }
+    cout << "----Test \"Nearest\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing Quadtree::OPT_COMPRESS.
+void testCompress()
+{
+    cout << "----Test \"Compress\"---- BEGIN" << endl
+         << "\tTesting the compressed tree on points at the same location." << endl << endl;
+    {
+        Quadtree testTree(-10, 20, -10, 20, 6, Quadtree::OPT_COMPRESS);
+        Vector2 pos1(3.5f, 3.5f), pos2(3.5f, 3.5f), pos3(-5, -5);
+
+        PAUSE();
+        cout << "----> Test part 1: \"Adding nodes on same location (3.5, 3.5)\"" << endl
+             << "\tShould subdivide root once, the leaf at (3.5, 3.5) at max depth (=6)." << endl;
+        PAUSE();
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Adding node (-5, -5)\"" << endl
+             << "\tShould place (-5, -5) in a leaf of root, (3.5, 3.5) unchanged." << endl;
+        PAUSE();
+
+        testTree.addPos(&pos3);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Moving (3.5, 3.5) to (3, 3)\"" << endl
+             << "\tShould make room for (3, 3) in the quadrant of the shrunk node." << endl;
+        PAUSE();
+
+        pos2 = Vector2(3, 3);
+        testTree.updatePos(&pos2);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 4: \"Removing (3, 3)\"" << endl
+             << "\tShould collapse to one leaf holding (3.5, 3.5), at the depth of \"Test part 3\"." << endl;
+        PAUSE();
+
+        testTree.removePos(&pos2);
+        cout << testTree << endl;
+    }
+    cout << "----Test \"Compress\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing the try-variants, misses are returned instead of thrown.
+void testStatus()
+{
+    static const char *names[] = { "ST_OK", "ST_OUT_OF_BOUND", "ST_NOT_FOUND" };
+
+    cout << "----Test \"Status\"---- BEGIN" << endl
+         << "\tTesting adding, removing and updating without exceptions." << endl << endl;
+    {
+        Quadtree testTree(-10, 20, -10, 20, 5);
+        Vector2 pos1(-1, -1), pos2(0, 0), pos3(-100, -100), pos4(1, 1);
+
+        PAUSE();
+        cout << "----> Test part 1: \"Adding (-1, -1), (0, 0) and (-100, -100)\"" << endl
+             << "\tShould be ST_OK, ST_OK and ST_OUT_OF_BOUND, (-100, -100) not in tree." << endl;
+        PAUSE();
+
+        cout << names[ testTree.tryAddPos(&pos1) ] << endl;
+        cout << names[ testTree.tryAddPos(&pos2) ] << endl;
+        cout << names[ testTree.tryAddPos(&pos3) ] << endl;
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Removing (1, 1) not in tree, moving (0, 0) outside scene\"" << endl
+             << "\tShould be ST_NOT_FOUND and ST_OUT_OF_BOUND, the tree unchanged." << endl;
+        PAUSE();
+
+        cout << names[ testTree.tryRemovePos(&pos4) ] << endl;
+        pos2 = Vector2(50, 0);
+        cout << names[ testTree.tryUpdatePos(&pos2) ] << endl;
+        pos2 = Vector2(0, 0);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Removing all four as a batch\"" << endl
+             << "\tShould be ST_OK, ST_OK, ST_OUT_OF_BOUND, ST_NOT_FOUND and 2 misses, the tree empty." << endl;
+        PAUSE();
+
+        IRO_Point2D     *points[4] = { &pos1, &pos2, &pos3, &pos4 };
+        Quadtree::Status statuses[4];
+        int misses = testTree.tryRemoveMany(points, 4, statuses);
+
+        for (int i = 0; i < 4; i++)
+            cout << names[ statuses[i] ] << endl;
+        cout << misses << " misses" << endl;
+        cout << testTree << endl;
+    }
+    cout << "----Test \"Status\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing Quadtree::OPT_GROW.
+void testGrow()
+{
+    cout << "----Test \"Grow\"---- BEGIN" << endl
+         << "\tTesting adding and moving points outside the scene of a growing tree." << endl << endl;
+    {
+        Quadtree testTree(-10, 20, -10, 20, 5, Quadtree::OPT_GROW);
+        Vector2 pos1(-1, -1), pos2(1, 1), pos3(25, -15);
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 1: \"Adding (25, -15) outside the scene\"" << endl
+             << "\tShould double the root once towards (25, -15), region (-10, -30) to (30, 10)." << endl
+             << "\tThe old root should be the NW quadrant, unchanged." << endl;
+        PAUSE();
+
+        testTree.addPos(&pos3);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Moving (1, 1) to (-100, 100)\"" << endl
+             << "\tShould double the root twice more, region (-130, -30) to (30, 130)." << endl;
+        PAUSE();
+
+        pos2 = Vector2(-100, 100);
+        testTree.updatePos(&pos2);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Trying to trigger exception\"" << endl
+             << "\tShould throw QE_outOfBound exception and return ST_OUT_OF_BOUND when adding (-2.7e38, 0)," << endl
+             << "\tthe bounds would overflow before reaching it. The tree should be unchanged." << endl;
+        PAUSE();
+
+        Vector2 farPos(-2.7e38f, 0);
+        try
+        {
+            testTree.addPos(&farPos);
+        }
+        catch (exception &e)
+        {
+            cout << e.what() << endl;
+        }
+        cout << ( (testTree.tryAddPos(&farPos) == Quadtree::ST_OUT_OF_BOUND) ? "ST_OUT_OF_BOUND" : "ST_OK" ) << endl;
+        cout << testTree << endl;
+    }
+    cout << "----Test \"Grow\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing Quadtree::beginBatch and Quadtree::commit.
+void testBatch()
+{
+    cout << "----Test \"Batch\"---- BEGIN" << endl
+         << "\tTesting changes restructuring the tree only at commit." << endl << endl;
+    {
+        vector<IRO_Point2D *> posVec;
+
+        Quadtree testTree(-10, 20, -10, 20, 5);
+        Vector2 pos1(-5, -5), pos2(5, 5), pos3(6, 6), pos4(7, 7);
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 1: \"Moving (5, 5) to (-4, -4) and adding (6, 6) in a batch\"" << endl
+             << "\tShould not subdivide, the SW leaf holds (-5, -5) and (-4, -4), the NE leaf (6, 6)." << endl
+             << "\tGetting at (-5, -5) should return both points of the SW leaf." << endl;
+        PAUSE();
+
+        testTree.beginBatch();
+        pos2 = Vector2(-4, -4);
+        testTree.updatePos(&pos2);
+        testTree.addPos(&pos3);
+        cout << testTree << endl;
+
+        posVec = testTree.getContentAt(-5, -5);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Committing\"" << endl
+             << "\tShould subdivide the SW leaf until (-5, -5) and (-4, -4) are apart." << endl
+             << "\tGetting at (-5, -5) should return only (-5, -5)." << endl;
+        PAUSE();
+
+        testTree.commit();
+        cout << testTree << endl;
+
+        posVec = testTree.getContentAt(-5, -5);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Adding and removing (7, 7), moving (-4, -4) to (4, -4) in one batch\"" << endl
+             << "\tThe NE leaf is never subdivided, the SW subtree is merged to one leaf holding (-5, -5)" << endl
+             << "\tand the SE leaf holds (4, -4)." << endl;
+        PAUSE();
+
+        testTree.beginBatch();
+        testTree.addPos(&pos4);
+        testTree.removePos(&pos4);
+        pos2 = Vector2(4, -4);
+        testTree.updatePos(&pos2);
+        testTree.commit();
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 4: \"Trying to trigger exception\"" << endl
+             << "\tShould throw QE_outOfBound exception when updating many with (6, 6) moved to (50, 50)" << endl
+             << "\tand close the batch. Adding (7, 7) should then subdivide the NE leaf." << endl;
+        PAUSE();
+
+        IRO_Point2D *points[1] = { &pos3 };
+        pos3 = Vector2(50, 50);
+        try
+        {
+            testTree.updateMany(points, 1);
+        }
+        catch (exception &e)
+        {
+            cout << e.what() << endl;
+        }
+        pos3 = Vector2(6, 6);
+        cout << ( testTree.inBatch() ? "In batch" : "Not in batch" ) << endl;
+
+        testTree.addPos(&pos4);
+        cout << testTree << endl;
+    }
+    cout << "----Test \"Batch\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing LinearQuadtree.
+void testLinear()
+{
+    cout << "----Test \"Linear\"---- BEGIN" << endl
+         << "\tTesting the pointerless tree." << endl << endl;
+    {
+        vector<IRO_Point2D *> posVec;
+
+        LinearQuadtree testTree(-10, 20, -10, 20, 5);
+        Vector2 pos1(1, 1), pos2(1, 1), pos3(3, 3);
+
+        PAUSE();
+        cout << "----> Test part 1: \"Adding (1, 1) twice and (3, 3)\"" << endl
+             << "\tShould show three entries, the coincident points with the same code." << endl
+             << "\tGetting at (1, 1) should return both coincident points." << endl;
+        PAUSE();
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+        testTree.addPos(&pos3);
+        cout << testTree << endl;
+
+        posVec = testTree.getContentAt(1, 1);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Moving (3, 3) to (-7, -7) and removing one (1, 1)\"" << endl
+             << "\tShould show two entries, (-7, -7) sorted first." << endl
+             << "\tGetting in rectangle (-10, -10, 0, 0) should return (-7, -7)." << endl;
+        PAUSE();
+
+        pos3 = Vector2(-7, -7);
+        testTree.updatePos(&pos3);
+        testTree.removePos(&pos2);
+        cout << testTree << endl;
+
+        posVec = testTree.getContentInRect(-10, -10, 0, 0);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+    }
+    {
+        vector<IRO_Point2D *> posVec;
+
+        LinearQuadtree testTree(-10, 20, -10, 20, 0);
+        Vector2 pos1(-5, -5), pos2(5, 5);
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+
+        PAUSE();
+        cout << "----> Test part 3: \"Max depth 0\"" << endl
+             << "\tShould show both points with code 0, the root is the only leaf." << endl
+             << "\tGetting at (9, -9) should return both points." << endl;
+        PAUSE();
+
+        cout << testTree << endl;
+
+        posVec = testTree.getContentAt(9, -9);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+    }
+    {
+        vector<IRO_Point2D *> posVec;
+
+        LinearQuadtree testTree(-10, 20, -10, 20, LinearQuadtree::MAX_DEPTH);
+        Vector2 pos1(.1f, .1f), pos2(.1001f, .1f);
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+
+        PAUSE();
+        cout << "----> Test part 4: \"Max depth 32\"" << endl
+             << "\tShould show two different codes using all 64 bits, though both points print as (0.10, 0.10)." << endl
+             << "\tGetting at (0.1, 0.1) should return only (0.1, 0.1)." << endl;
+        PAUSE();
+
+        cout << testTree << endl;
+
+        posVec = testTree.getContentAt(.1f, .1f);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+    }
+    cout << "----Test \"Linear\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing the bucket size and merge size of Quadtree.
+void testBucket()
+{
+    cout << "----Test \"Bucket\"---- BEGIN" << endl
+         << "\tTesting subdividing above bucket size and merging at merge size." << endl << endl;
+    {
+        Quadtree testTree(-10, 20, -10, 20, 5, Quadtree::OPT_NONE, 3, 1);
+        Vector2 pos1(1, 1), pos2(2, 2), pos3(-5, -5), pos4(-6, -6);
+
+        PAUSE();
+        cout << "----> Test part 1: \"Adding three points, bucket size 3\"" << endl
+             << "\tShould show the root as a leaf holding all three." << endl;
+        PAUSE();
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+        testTree.addPos(&pos3);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Adding a fourth point\"" << endl
+             << "\tShould subdivide the root once, NE and SW holding two points each." << endl;
+        PAUSE();
+
+        testTree.addPos(&pos4);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Removing (2, 2) and (1, 1), merge size 1\"" << endl
+             << "\tShould not merge, the root stays subdivided holding two points." << endl;
+        PAUSE();
+
+        testTree.removePos(&pos2);
+        testTree.removePos(&pos1);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 4: \"Removing (-6, -6)\"" << endl
+             << "\tShould merge the root to a leaf holding (-5, -5)." << endl;
+        PAUSE();
+
+        testTree.removePos(&pos4);
+        cout << testTree << endl;
+    }
+    {
+        Quadtree testTree(-10, 20, -10, 20, 5, Quadtree::OPT_NONE, 1, 0);
+        Vector2 pos1(1, 1), pos2(-5, -5);
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+
+        PAUSE();
+        cout << "----> Test part 5: \"Removing (1, 1), bucket size 1 and merge size 0\"" << endl
+             << "\tShould not merge, the SW leaf holds (-5, -5)." << endl;
+        PAUSE();
+
+        testTree.removePos(&pos1);
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 6: \"Removing (-5, -5)\"" << endl
+             << "\tShould merge the root to an empty leaf." << endl;
+        PAUSE();
+
+        testTree.removePos(&pos2);
+        cout << testTree << endl;
+    }
+    cout << "----Test \"Bucket\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing Quadtree::getContentInRadius(float, float, float).
+void testRadius()
+{
+    cout << "----Test \"Radius\"---- BEGIN" << endl
+         << "\tTesting getting content in a circle." << endl << endl;
+    {
+        vector<IRO_Point2D *> posVec;
+
+        Quadtree testTree(-10, 20, -10, 20, 5);
+        Vector2 pos1(0, 0), pos2(3, 4), pos3(2.99f, 4), pos4(3, 4.01f), pos5(-8, -8);
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+        testTree.addPos(&pos3);
+        testTree.addPos(&pos4);
+        testTree.addPos(&pos5);
+
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 1: \"Get in radius 5 around (0, 0)\"" << endl
+             << "\tShould return (0, 0), (3, 4) on the circle and (2.99, 4) just inside," << endl
+             << "\tnot (3, 4.01) just outside." << endl;
+        PAUSE();
+
+        posVec = testTree.getContentInRadius(0, 0, 5);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Get in radius 0 around (3, 4)\"" << endl
+             << "\tShould return only (3, 4)." << endl;
+        PAUSE();
+
+        posVec = testTree.getContentInRadius(3, 4, 0);
+
+        cout << "Content: \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << "(" << posVec[i]->getX() << ", " << posVec[i]->getY() << ") ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Trying to trigger exception\"" << endl
+             << "\tShould throw QE_badRadius exception for radius -1." << endl;
+        PAUSE();
+
+        try
+        {
+            posVec = testTree.getContentInRadius(0, 0, -1);
+        }
+        catch (exception &e)
+        {
+            cout << e.what() << endl;
+        }
+    }
+    cout << "----Test \"Radius\"---- END" << endl;
+    PAUSE();
+}
+
+//Testing Quadtree::query.
+void testQuery()
+{
+    cout << "----Test \"Query\"---- BEGIN" << endl
+         << "\tTesting running a batch of mixed queries." << endl << endl;
+    {
+        vector<IRO_Point2D *> results[3];
+
+        Quadtree testTree(-10, 20, -10, 20, 5);
+        Vector2 pos1(.1, .1), pos2(5, 5), pos3(5.01, 5), pos4(-5, -5), pos5(3, 4);
+
+        testTree.addPos(&pos1);
+        testTree.addPos(&pos2);
+        testTree.addPos(&pos3);
+        testTree.addPos(&pos4);
+        testTree.addPos(&pos5);
+
+        Quadtree::Query queries[3] = { Quadtree::Query::at(5, 5),
+                                       Quadtree::Query::inRect(-10, -10, 1, 1),
+                                       Quadtree::Query::inRadius(0, 0, 5) };
+
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 1: \"At (5, 5), in rectangle (-10, -10, 1, 1) and in radius 5 around (0, 0), one thread\"" << endl
+             << "\tShould return (5, 5) and (5.01, 5), then (0.1, 0.1) and (-5, -5), then (0.1, 0.1) and (3, 4)." << endl;
+        PAUSE();
+
+        testTree.query(queries, 3, results);
+
+        for (int q = 0; q < 3; q++)
+        {
+            cout << "Content: \"";
+            for (size_t i = 0; i < results[q].size(); i++)
+                cout << "(" << results[q][i]->getX() << ", " << results[q][i]->getY() << ") ";
+            cout << "\"" << endl;
+        }
+
+        PAUSE();
+        cout << "----> Test part 2: \"Same queries on a pool of two threads\"" << endl
+             << "\tShould return the same content as part 1." << endl;
+        PAUSE();
+
+        ThreadPool threads(2);
+        testTree.query(queries, 3, results, threads);
+
+        for (int q = 0; q < 3; q++)
+        {
+            cout << "Content: \"";
+            for (size_t i = 0; i < results[q].size(); i++)
+                cout << "(" << results[q][i]->getX() << ", " << results[q][i]->getY() << ") ";
+            cout << "\"" << endl;
+        }
+    }
+    cout << "----Test \"Query\"---- END" << endl;
+    PAUSE();
+}
+
+/** \class ArrayIdGetter
+ *  \brief Gives the index of a vector in an array as its id.
+ *
+ * Used in automated test.
+ */
+class ArrayIdGetter : public Quadtree::IdGetter
+{
+    public:
+        /**
+         * Creates the getter of the array.
+         */
+        explicit ArrayIdGetter(const Vector2 *a): arr(a) {}
+
+        uint64_t getId(const IRO_Point2D &pos) { return static_cast<const Vector2 *>(&pos) - arr; }
+
+        ///First vector of array.
+        const Vector2 *arr;
+};
+
+//Testing Quadtree::save and QuadtreeSnapshot.
+void testSnapshot()
+{
+    cout << "----Test \"Snapshot\"---- BEGIN" << endl
+         << "\tTesting saving a tree and querying the snapshot file." << endl << endl;
+    {
+        vector<IRO_Point2D *> posVec;
+        vector<uint64_t>      idVec;
+
+        Quadtree testTree(-10, 20, -10, 20, 5);
+        Vector2 posArr[5] = { Vector2(.1, .1), Vector2(5, 5), Vector2(5.01, 5), Vector2(-5, -5), Vector2(-5, 5) };
+        ArrayIdGetter getter(posArr);
+
+        for (int i = 0; i < 5; i++)
+            testTree.addPos(&posArr[i]);
+
+        cout << testTree << endl;
+
+        PAUSE();
+        cout << "----> Test part 1: \"Saving and opening\"" << endl
+             << "\tShould show 5 points and max depth 5." << endl;
+        PAUSE();
+
+        testTree.save("autoTest.snapshot", getter);
+        QuadtreeSnapshot snapshot("autoTest.snapshot");
+
+        cout << snapshot.getSize() << " points, max depth " << snapshot.getMaxDepth() << endl;
+
+        PAUSE();
+        cout << "----> Test part 2: \"Get at (5, 5)\"" << endl
+             << "\tShould show ids 1 and 2 for both the tree and the snapshot." << endl;
+        PAUSE();
+
+        posVec = testTree.getContentAt(5, 5);
+        cout << "Tree:     \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << getter.getId(*posVec[i]) << " ";
+        cout << "\"" << endl;
+
+        idVec = snapshot.getContentAt(5, 5);
+        cout << "Snapshot: \"";
+        for (size_t i = 0; i < idVec.size(); i++)
+            cout << idVec[i] << " ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 3: \"Get in rectangle (-10, -10, 1, 1)\"" << endl
+             << "\tShould show ids 0 and 3 for both the tree and the snapshot." << endl;
+        PAUSE();
+
+        posVec = testTree.getContentInRect(-10, -10, 1, 1);
+        cout << "Tree:     \"";
+        for (size_t i = 0; i < posVec.size(); i++)
+            cout << getter.getId(*posVec[i]) << " ";
+        cout << "\"" << endl;
+
+        idVec = snapshot.getContentInRect(-10, -10, 1, 1);
+        cout << "Snapshot: \"";
+        for (size_t i = 0; i < idVec.size(); i++)
+            cout << idVec[i] << " ";
+        cout << "\"" << endl;
+
+        PAUSE();
+        cout << "----> Test part 4: \"Trying to trigger exception\"" << endl
+             << "\tShould throw QE_badFile exception when opening a copy with the root as its own child." << endl;
+        PAUSE();
+
+        vector<char> file;
+        FILE *in = fopen("autoTest.snapshot", "rb");
+        for (int c = fgetc(in); c != EOF; c = fgetc(in))
+            file.push_back(static_cast<char>(c));
+        fclose(in);
+
+        QuadtreeSnapshot_header header;
+        QuadtreeSnapshot_node   root;
+        memcpy(&header, &file[0], sizeof(header));
+        memcpy(&root, &file[header.nodesOffset], sizeof(root));
+        root.child = 0;
+        memcpy(&file[header.nodesOffset], &root, sizeof(root));
+
+        FILE *out = fopen("autoTestCorrupt.snapshot", "wb");
+        fwrite(&file[0], 1, file.size(), out);
+        fclose(out);
+
+        try
+        {
+            QuadtreeSnapshot corrupt("autoTestCorrupt.snapshot");
+        }
+        catch (exception &e)
+        {
+            cout << e.what() << endl;
+        }
+    }
+    remove("autoTest.snapshot");
+    remove("autoTestCorrupt.snapshot");
+    cout << "----Test \"Snapshot\"---- END" << endl;
+    PAUSE();
+}
@@ -25,4 +25,59 @@ void testGet();
  */
 void testGetRect();
 
+/**
+ *  \brief Tests building a tree from an array of points.
+ */
+void testBuild();
+
+/**
+ *  \brief Tests getting the points nearest to a location.
+ */
+void testNearest();
+
+/**
+ *  \brief Tests the compressed tree.
+ */
+void testCompress();
+
+/**
+ *  \brief Tests the status-returning try-variants of adding, removing and updating.
+ */
+void testStatus();
+
+/**
+ *  \brief Tests growing the scene towards points outside it.
+ */
+void testGrow();
+
+/**
+ *  \brief Tests batches of changes committed at once.
+ */
+void testBatch();
+
+/**
+ *  \brief Tests the linear (pointerless) tree.
+ */
+void testLinear();
+
+/**
+ *  \brief Tests subdividing above the bucket size and merging at the merge size.
+ */
+void testBucket();
+
+/**
+ *  \brief Tests getting from a circular region.
+ */
+void testRadius();
+
+/**
+ *  \brief Tests running a batch of queries.
+ */
+void testQuery();
+
+/**
+ *  \brief Tests saving a tree to a snapshot and querying the snapshot.
+ */
+void testSnapshot();
+
 #endif
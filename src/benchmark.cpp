@@ -0,0 +1,370 @@
+/** \file benchmark.cpp
+ *  \brief Non-interactive benchmark of the Point Region Quadtree.
+ *
+ *  Separate program from the tests, built from this file, Quadtree.cpp, QuadtreeSnapshot.cpp
+ *  and ThreadPool.cpp. Times every operation of \link Quadtree \endlink on synthetic point
+ *  distributions at sizes from 1e3 up to a maximum (1e7 with --max-n=10000000).
+ *
+ *  Prints one JSON object per line and per (distribution, size, operation) to stdout:
+ *  operations per second, p50 and p99 latency in nanoseconds and heap allocations per operation.
+ *
+ *  Options:
+ *    --max-n=N     Largest number of points, sizes are the powers of ten from 1e3 (default 1e6).
+ *    --ops=N       Most operations timed per run, except adding which adds every point (default 1e4).
+ *    --depth=N     Max depth of the tree (default 16).
+ *    --bucket=N    Bucket size of the leaves (default 8).
+ *    --no-index    Without Quadtree::OPT_INDEX, moving to another leaf then searches the tree.
+ *    --compress    With Quadtree::OPT_COMPRESS.
+ */
+
+#include "Quadtree.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+//----Allocation counting----
+
+/**
+ * Number of heap allocations made by the program, counted by the replaced operator new.
+ */
+static unsigned long long g_allocs = 0;
+
+void *operator new(size_t size)
+{
+    g_allocs++;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+//----Points----
+
+/** \class BenchPoint
+ *  \brief Point moved by the benchmark.
+ */
+class BenchPoint : public IRO_Point2D
+{
+    public:
+        float getX() const { return x; }
+        float getY() const { return y; }
+
+        float x, y;
+};
+
+static const float SCENE = 1000.0f;     ///< The scene is [0, SCENE) x [0, SCENE).
+
+/**
+ * Generator of one synthetic distribution.
+ */
+class Distribution
+{
+    public:
+        static const int UNIFORM    = 0;   ///< Uniform over the scene.
+        static const int CLUSTERED  = 1;   ///< Gaussian clusters around 16 centers.
+        static const int COINCIDENT = 2;   ///< Only 16 distinct locations.
+        static const int LINE       = 3;   ///< On a diagonal line.
+        static const int COUNT      = 4;
+
+        Distribution(int type, unsigned seed)
+        :   m_type(type), m_rand(seed), m_unit(0.0f, 1.0f), m_normal(0.0f, SCENE / 100.0f)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                m_centers[i][0] = SCENE * (0.1f + 0.8f * m_unit(m_rand));
+                m_centers[i][1] = SCENE * (0.1f + 0.8f * m_unit(m_rand));
+            }
+        }
+
+        static const char *getName(int type)
+        {
+            static const char *names[COUNT] = { "uniform", "clustered", "coincident", "line" };
+            return names[type];
+        }
+
+        //Generates a location inside the scene.
+        void next(float &x, float &y)
+        {
+            int c = static_cast<int>(m_rand() % 16);
+
+            switch (m_type)
+            {
+                case UNIFORM:
+                    x = SCENE * m_unit(m_rand);
+                    y = SCENE * m_unit(m_rand);
+                    break;
+                case CLUSTERED:
+                    x = clamp(m_centers[c][0] + m_normal(m_rand));
+                    y = clamp(m_centers[c][1] + m_normal(m_rand));
+                    break;
+                case COINCIDENT:
+                    x = m_centers[c][0];
+                    y = m_centers[c][1];
+                    break;
+                default:
+                    x = SCENE * m_unit(m_rand);
+                    y = clamp(0.2f * SCENE + 0.6f * x);
+                    break;
+            }
+        }
+
+        std::mt19937 &getRand() { return m_rand; }
+
+    private:
+        static float clamp(float v)
+        { return std::min(std::max(v, 0.0f), std::nextafter(SCENE, 0.0f)); }
+
+        int                                   m_type;
+        std::mt19937                          m_rand;
+        std::uniform_real_distribution<float> m_unit;
+        std::normal_distribution<float>       m_normal;
+        float                                 m_centers[16][2];
+};
+
+//----Timing----
+
+/**
+ * Latencies of one run of an operation.
+ * The storage is reserved before the run, so recording allocates nothing.
+ */
+class Timer
+{
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        explicit Timer(int n) { m_ns.reserve(n); }
+
+        void start()
+        {
+            m_ns.clear();
+            m_allocs = g_allocs;
+            m_begin  = Clock::now();
+        }
+        void begin()  { m_opBegin = Clock::now(); }
+        void end()
+        {
+            m_ns.push_back( std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_opBegin).count() );
+        }
+
+        //Prints the run as one JSON line.
+        void report(const char *dist, int n, const char *op)
+        {
+            double             total  = std::chrono::duration<double>(Clock::now() - m_begin).count();
+            unsigned long long allocs = g_allocs - m_allocs;
+            int                ops    = static_cast<int>( m_ns.size() );
+
+            if (!ops)
+                return;
+
+            std::sort(m_ns.begin(), m_ns.end());
+
+            std::printf("{\"dist\":\"%s\",\"n\":%d,\"op\":\"%s\",\"ops\":%d,\"ops_per_sec\":%.0f,"
+                        "\"p50_ns\":%lld,\"p99_ns\":%lld,\"allocs_per_op\":%.3f}\n",
+                        dist, n, op, ops, ops / total,
+                        m_ns[ops / 2], m_ns[std::min(ops - 1, (ops * 99) / 100)],
+                        static_cast<double>(allocs) / ops);
+            std::fflush(stdout);
+        }
+
+    private:
+        std::vector<long long> m_ns;
+        Clock::time_point      m_begin, m_opBegin;
+        unsigned long long     m_allocs;
+};
+
+//----Runs----
+
+/**
+ * Settings of the benchmark, read from the command line.
+ */
+struct Settings
+{
+    int maxN;
+    int maxOps;
+    int depth;
+    int bucket;
+    int options;
+};
+
+//Runs every operation on one tree of n points.
+static void runAll(const Settings &settings, int type, int n)
+{
+    const char *dist = Distribution::getName(type);
+    const int   m    = std::min(n, settings.maxOps);
+
+    Distribution gen(type, 1234u + n);
+    std::vector<BenchPoint> points(n);
+    for (int i = 0; i < n; i++)
+        gen.next(points[i].x, points[i].y);
+
+    //Points and query locations are picked in a random order, the same for every operation.
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), gen.getRand());
+
+    Quadtree tree(0.0f, SCENE, 0.0f, SCENE, settings.depth, settings.options, settings.bucket,
+                  std::max(1, settings.bucket / 2));
+    Timer    timer(n);
+
+    timer.start();
+    for (int i = 0; i < n; i++)
+    {
+        timer.begin();
+        tree.addPos(&points[i]);
+        timer.end();
+    }
+    timer.report(dist, n, "addPos");
+
+    //Queries at stored locations, they are never empty.
+    timer.start();
+    for (int i = 0; i < m; i++)
+    {
+        const BenchPoint &p = points[order[i]];
+
+        timer.begin();
+        std::vector<IRO_Point2D *> found = tree.getContentAt(p.x, p.y);
+        timer.end();
+    }
+    timer.report(dist, n, "getContentAt");
+
+    //Rectangles expected to hold about 16 points of a uniform scene.
+    float side = SCENE * std::sqrt(16.0f / n);
+    timer.start();
+    for (int i = 0; i < m; i++)
+    {
+        const BenchPoint &p = points[order[i]];
+
+        timer.begin();
+        std::vector<IRO_Point2D *> found = tree.getContentInRect(p.x - side / 2, p.y - side / 2,
+                                                                 p.x + side / 2, p.y + side / 2);
+        timer.end();
+    }
+    timer.report(dist, n, "getContentInRect");
+
+    //Moves far smaller than a leaf at max depth, nearly all stay in the same leaf.
+    float jitter = SCENE / static_cast<float>(1 << std::min(settings.depth, 24)) / 64.0f;
+    timer.start();
+    for (int i = 0; i < m; i++)
+    {
+        BenchPoint &p = points[order[i]];
+        float x = p.x + jitter, y = p.y + jitter;
+
+        if ( (x < SCENE) && (y < SCENE) )
+        {
+            p.x = x;
+            p.y = y;
+        }
+
+        timer.begin();
+        tree.updatePos(&p);
+        timer.end();
+    }
+    timer.report(dist, n, "updatePos_sameLeaf");
+
+    //Moves to a new location of the distribution, nearly all leave their leaf.
+    timer.start();
+    for (int i = 0; i < m; i++)
+    {
+        BenchPoint &p = points[order[n - 1 - i]];
+        gen.next(p.x, p.y);
+
+        timer.begin();
+        tree.updatePos(&p);
+        timer.end();
+    }
+    timer.report(dist, n, "updatePos_crossLeaf");
+
+    timer.start();
+    for (int i = 0; i < m; i++)
+    {
+        timer.begin();
+        tree.removePos(&points[order[i]]);
+        timer.end();
+    }
+    timer.report(dist, n, "removePos");
+}
+
+//Reads the integer of an option like --name=value.
+static bool readOption(const char *arg, const char *name, int &value)
+{
+    size_t len = std::strlen(name);
+
+    if ( (std::strncmp(arg, name, len) != 0) || (arg[len] != '=') )
+        return false;
+
+    value = static_cast<int>( std::strtod(arg + len + 1, 0) ); //Accepts 1e7.
+    return true;
+}
+
+/**
+ * \brief Start of benchmark.
+ */
+int main(int argc, char **argv)
+{
+    Settings settings = { 1000000, 10000, 16, 8, Quadtree::OPT_INDEX };
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ( readOption(argv[i], "--max-n",  settings.maxN)   ||
+             readOption(argv[i], "--ops",    settings.maxOps) ||
+             readOption(argv[i], "--depth",  settings.depth)  ||
+             readOption(argv[i], "--bucket", settings.bucket) )
+        {
+            continue;
+        }
+        else if (std::strcmp(argv[i], "--no-index") == 0)
+        {
+            settings.options &= ~Quadtree::OPT_INDEX;
+        }
+        else if (std::strcmp(argv[i], "--compress") == 0)
+        {
+            settings.options |= Quadtree::OPT_COMPRESS;
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    for (int type = 0; type < Distribution::COUNT; type++)
+    {
+        for (long long n = 1000; n <= settings.maxN; n *= 10)
+            runAll(settings, type, static_cast<int>(n));
+    }
+
+    return 0;
+}
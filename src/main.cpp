@@ -48,6 +48,17 @@ int main()
                 testMove();
                 testGet();
                 testGetRect();
+                testBuild();
+                testNearest();
+                testCompress();
+                testStatus();
+                testGrow();
+                testBatch();
+                testLinear();
+                testBucket();
+                testRadius();
+                testQuery();
+                testSnapshot();
                 break;
 
             case INTER_TEST:
@@ -0,0 +1,112 @@
+/** \file traceDump.cpp
+ *  \brief Offline converter of trace files to a Chrome trace timeline.
+ *
+ *  Separate program, built from this file and QuadtreeTrace.cpp.
+ *  Reads a file written by \link QuadtreeTrace::dump \endlink and writes a Chrome trace JSON file,
+ *  which opens in chrome://tracing and in the Perfetto UI. Every event is an instant event on
+ *  the timeline of its thread, with the node, depth and argument as event arguments.
+ *
+ *  Usage: traceDump trace.bin trace.json
+ */
+
+#include "QuadtreeTrace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/**
+ * Events of one thread read from the trace file.
+ */
+struct ThreadEvents
+{
+    uint32_t                         thread;
+    std::vector<QuadtreeTrace_event> events;
+};
+
+//Reads all threads, false if the file is not a complete trace file.
+static bool readTrace(std::FILE *in, std::vector<ThreadEvents> &threads)
+{
+    char magic[8];
+    if ( (std::fread(magic, 1, 8, in) != 8) || (std::memcmp(magic, "PRQTTRC1", 8) != 0) )
+        return false;
+
+    uint32_t record[2];
+    while (std::fread(record, sizeof(record), 1, in) == 1)
+    {
+        threads.push_back( ThreadEvents() );
+        threads.back().thread = record[0];
+        threads.back().events.resize(record[1]);
+
+        if ( record[1] &&
+             (std::fread(&threads.back().events[0], sizeof(QuadtreeTrace_event), record[1], in) != record[1]) )
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Start of converter.
+ */
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: %s trace.bin trace.json\n", argv[0]);
+        return 1;
+    }
+
+    std::FILE *in = std::fopen(argv[1], "rb");
+    std::vector<ThreadEvents> threads;
+
+    if ( !in || !readTrace(in, threads) )
+    {
+        std::fprintf(stderr, "Cannot read trace file %s\n", argv[1]);
+        if (in)
+            std::fclose(in);
+        return 1;
+    }
+    std::fclose(in);
+
+    std::FILE *out = std::fopen(argv[2], "w");
+    if (!out)
+    {
+        std::fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+
+    //The timeline starts at the first event of any thread.
+    uint64_t start = ~0ULL;
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        if ( !threads[t].events.empty() && (threads[t].events[0].time < start) )
+            start = threads[t].events[0].time;
+    }
+
+    std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    bool first = true;
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                          "\"args\":{\"name\":\"thread %u\"}}",
+                     first ? "" : ",\n", threads[t].thread, threads[t].thread);
+        first = false;
+
+        for (size_t i = 0; i < threads[t].events.size(); i++)
+        {
+            const QuadtreeTrace_event &e = threads[t].events[i];
+
+            //Timestamps are in microseconds.
+            std::fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"quadtree\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                              "\"pid\":1,\"tid\":%u,\"args\":{\"node\":\"0x%llx\",\"depth\":%d,\"arg\":%u}}",
+                         QuadtreeTrace::getName(e.op), (e.time - start) / 1000.0, threads[t].thread,
+                         static_cast<unsigned long long>(e.node), e.depth, e.arg);
+        }
+    }
+
+    std::fprintf(out, "\n]}\n");
+
+    return (std::fclose(out) == 0) ? 0 : 1;
+}